@@ -28,6 +28,94 @@
 
 namespace libmspub
 {
+
+/** Settings that change how a document is parsed and which pages are output.
+ */
+class MSPUBParseOptions
+{
+public:
+  PUBAPI MSPUBParseOptions();
+  PUBAPI MSPUBParseOptions(const MSPUBParseOptions &other);
+  PUBAPI ~MSPUBParseOptions();
+  PUBAPI MSPUBParseOptions &operator=(const MSPUBParseOptions &other);
+
+  /** Sets the number of threads used to decode text, shapes and images, and to paint pages.
+   *
+   * The default is 1, which does all the work on the calling thread;
+   * 0 uses one thread per hardware thread. The painter is always called
+   * from the calling thread, and in the same order whatever the count.
+   */
+  PUBAPI void setThreadCount(unsigned count);
+  PUBAPI unsigned getThreadCount() const;
+
+  /** Sets whether the independent streams of a document are parsed concurrently.
+   *
+   * The thread count is then shared between the streams, but each of
+   * them gets at least one thread, so this uses two threads even if the
+   * thread count is 1. It is off by default, and only has an effect on
+   * Publisher 2002 and later files.
+   */
+  PUBAPI void setPipelined(bool pipelined);
+  PUBAPI bool isPipelined() const;
+
+  /** Adds the page with the given zero-based index to the pages to output.
+   *
+   * The index counts the pages that would be output without a selection.
+   * If no page is selected, all pages are output. The shapes of the
+   * other pages are not prepared at all, and master pages are only
+   * painted behind the selected pages that use them.
+   */
+  PUBAPI void selectPage(unsigned index);
+  /// Selects all pages again.
+  PUBAPI void selectAllPages();
+  /// Returns whether the page with the given zero-based index is output.
+  PUBAPI bool isPageSelected(unsigned index) const;
+
+private:
+  struct Impl;
+  Impl *m_impl;
+};
+
+/** A parsed document, which can be painted any number of times.
+ *
+ * The document does not change once parsed, so render() may be called
+ * concurrently from different threads, each with its own painter. It
+ * does not refer to the input stream it was parsed from.
+ */
+class MSPUBParsedDocument
+{
+public:
+  PUBAPI ~MSPUBParsedDocument();
+
+  /// Paints the document, like MSPUBDocument::parse() does.
+  PUBAPI bool render(librevenge::RVNGDrawingInterface *painter) const;
+
+  /// Returns the number of pages that render() paints.
+  PUBAPI unsigned getPageCount() const;
+  /// Returns the width of the pages in inches, or 0 if the document does not give it.
+  PUBAPI double getPageWidth() const;
+  /// Returns the height of the pages in inches, or 0 if the document does not give it.
+  PUBAPI double getPageHeight() const;
+
+private:
+  friend class MSPUBDocument;
+
+  struct Impl;
+
+  explicit MSPUBParsedDocument(Impl *impl);
+  MSPUBParsedDocument(const MSPUBParsedDocument &);
+  MSPUBParsedDocument &operator=(const MSPUBParsedDocument &);
+
+  Impl *m_impl;
+};
+
+/** Entry points of the library.
+ *
+ * All the functions may be called concurrently from different threads,
+ * as long as each call has its own input stream and painter: a parse
+ * keeps all of its state in objects it creates itself, and the library
+ * has no global state apart from constant tables.
+ */
 class MSPUBDocument
 {
 public:
@@ -35,6 +123,12 @@ public:
   static PUBAPI bool isSupported(librevenge::RVNGInputStream *input);
 
   static PUBAPI bool parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter);
+  static PUBAPI bool parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter, const MSPUBParseOptions &options);
+
+  static PUBAPI bool parseMetaData(librevenge::RVNGInputStream *input, librevenge::RVNGPropertyList &metaData);
+
+  static PUBAPI MSPUBParsedDocument *parseDocument(librevenge::RVNGInputStream *input);
+  static PUBAPI MSPUBParsedDocument *parseDocument(librevenge::RVNGInputStream *input, const MSPUBParseOptions &options);
 };
 
 } // namespace libmspub
@@ -22,8 +22,13 @@ struct BorderImgInfo
 {
   ImgType m_type;
   librevenge::RVNGBinaryData m_imgBlob;
+  // mime type and image data, the starting point of every tile drawn with
+  // this image. Only the work of encoding the image is shared: the painter
+  // interface has no way to refer to an image drawn before, so each tile
+  // still passes the whole image and the painter embeds it once per tile.
+  librevenge::RVNGPropertyList m_tileProps;
   BorderImgInfo(ImgType type) :
-    m_type(type), m_imgBlob()
+    m_type(type), m_imgBlob(), m_tileProps()
   {
   }
 };
@@ -32,8 +37,11 @@ struct BorderArtInfo
 {
   std::vector<BorderImgInfo> m_images;
   std::vector<unsigned> m_offsets;
+  // sorted; the n-th image belongs to the n-th offset in this order
   std::vector<unsigned> m_offsetsOrdered;
-  BorderArtInfo() : m_images(), m_offsets(), m_offsetsOrdered()
+  // index into m_images for each entry of m_offsets
+  std::vector<unsigned> m_offsetImages;
+  BorderArtInfo() : m_images(), m_offsets(), m_offsetsOrdered(), m_offsetImages()
   {
   }
 };
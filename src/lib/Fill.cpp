@@ -29,11 +29,11 @@ ImgFill::ImgFill(unsigned imgIndex, const MSPUBCollector *owner, bool isTexture,
 void ImgFill::getProperties(librevenge::RVNGPropertyList *out) const
 {
   out->insert("draw:fill", "bitmap");
-  if (m_imgIndex > 0 && m_imgIndex <= m_owner->m_images.size())
+  if (m_owner->m_images.hasImage(m_imgIndex))
   {
-    const std::pair<ImgType, librevenge::RVNGBinaryData> &img = m_owner->m_images[m_imgIndex - 1];
-    out->insert("librevenge:mime-type", mimeByImgType(img.first));
-    out->insert("draw:fill-image", img.second.getBase64Data());
+    out->insert("librevenge:mime-type", mimeByImgType(m_owner->m_images.getType(m_imgIndex)));
+    out->insert("draw:fill-image", m_owner->m_images.getData(m_imgIndex).getBase64Data());
+    m_owner->m_images.releaseUse(m_imgIndex);
     out->insert("draw:fill-image-ref-point", "top-left");
     if (! m_isTexture)
     {
@@ -48,6 +48,11 @@ void ImgFill::getProperties(librevenge::RVNGPropertyList *out) const
   }
 }
 
+unsigned ImgFill::getImgIndex() const
+{
+  return m_imgIndex;
+}
+
 PatternFill::PatternFill(unsigned imgIndex, const MSPUBCollector *owner, ColorReference fg, ColorReference bg) : ImgFill(imgIndex, owner, true, 0), m_fg(fg), m_bg(bg)
 {
 }
@@ -57,11 +62,10 @@ void PatternFill::getProperties(librevenge::RVNGPropertyList *out) const
   Color fgColor = m_fg.getFinalColor(m_owner->m_paletteColors);
   Color bgColor = m_bg.getFinalColor(m_owner->m_paletteColors);
   out->insert("draw:fill", "bitmap");
-  if (m_imgIndex > 0 && m_imgIndex <= m_owner->m_images.size())
+  if (m_owner->m_images.hasImage(m_imgIndex))
   {
-    const std::pair<ImgType, librevenge::RVNGBinaryData> &img = m_owner->m_images[m_imgIndex - 1];
-    const ImgType &type = img.first;
-    const librevenge::RVNGBinaryData *data = &img.second;
+    const ImgType type = m_owner->m_images.getType(m_imgIndex);
+    const librevenge::RVNGBinaryData *data = &m_owner->m_images.getData(m_imgIndex);
     // fix broken MSPUB DIB by putting in correct fg and bg colors
     librevenge::RVNGBinaryData fixedImg;
     if (type == DIB && data->size() >= 0x36 + 8)
@@ -81,6 +85,7 @@ void PatternFill::getProperties(librevenge::RVNGPropertyList *out) const
     out->insert("librevenge:mime-type", mimeByImgType(type));
     out->insert("draw:fill-image", data->getBase64Data());
     out->insert("draw:fill-image-ref-point", "top-left");
+    m_owner->m_images.releaseUse(m_imgIndex);
   }
 }
 
@@ -26,6 +26,11 @@ protected:
 public:
   Fill(const MSPUBCollector *owner);
   virtual void getProperties(librevenge::RVNGPropertyList *out) const = 0;
+  /// Returns the index of the image drawn by this fill, or 0 if there is none.
+  virtual unsigned getImgIndex() const
+  {
+    return 0;
+  }
   virtual ~Fill() { }
 private:
   Fill(const Fill &) : m_owner(nullptr) { }
@@ -43,6 +48,7 @@ protected:
 public:
   ImgFill(unsigned imgIndex, const MSPUBCollector *owner, bool isTexture, int rotation);
   void getProperties(librevenge::RVNGPropertyList *out) const override;
+  unsigned getImgIndex() const override;
 private:
   ImgFill(const ImgFill &) : Fill(nullptr), m_imgIndex(0), m_isTexture(false), m_rotation(0) { }
   ImgFill &operator=(const ImgFill &);
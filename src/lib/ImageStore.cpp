@@ -0,0 +1,268 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ImageStore.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "MemoryStream.h"
+#include "WorkerPool.h"
+#include "libmspub_utils.h"
+
+namespace libmspub
+{
+
+namespace
+{
+
+unsigned readLE(const unsigned char *const data, const unsigned size)
+{
+  unsigned value = 0;
+  for (unsigned i = size; i > 0; --i)
+    value = (value << 8) | data[i - 1];
+  return value;
+}
+
+librevenge::RVNGBinaryData makeBMP(const unsigned char *const data, const unsigned long size)
+{
+  // Reconstruct BMP header
+  // cf. http://en.wikipedia.org/wiki/BMP_file_format , accessed 2012-5-31
+  if (size < 0x2E + 4)
+  {
+    MSPUB_DEBUG_MSG(("Garbage DIB\n"));
+    return librevenge::RVNGBinaryData();
+  }
+  const unsigned bitsPerPixel = readLE(data + 0x0E, 2);
+  unsigned numPaletteColors = readLE(data + 0x20, 4);
+  if (numPaletteColors == 0 && bitsPerPixel <= 8)
+  {
+    numPaletteColors = 1;
+    for (unsigned i = 0; i < bitsPerPixel; ++i)
+    {
+      numPaletteColors *= 2;
+    }
+  }
+
+  const unsigned long fileSize = size + 14;
+  const unsigned char header[14] =
+  {
+    0x42, 0x4d,
+    (unsigned char)(fileSize & 0x000000ff),
+    (unsigned char)((fileSize & 0x0000ff00) >> 8),
+    (unsigned char)((fileSize & 0x00ff0000) >> 16),
+    (unsigned char)((fileSize & 0xff000000) >> 24),
+    0x00, 0x00, 0x00, 0x00,
+    (unsigned char)(0x36 + 4 * numPaletteColors), 0x00, 0x00, 0x00
+  };
+  librevenge::RVNGBinaryData bmp(header, sizeof(header));
+  bmp.append(data, size);
+  return bmp;
+}
+
+}
+
+librevenge::RVNGBinaryData decodeImage(const ImgType type, const unsigned char *const data, const unsigned long size, const unsigned long decodedSize)
+{
+  switch (type)
+  {
+  case WMF:
+  case EMF:
+    return inflateData(data, size, decodedSize);
+  case DIB:
+    return makeBMP(data, size);
+  default:
+    return librevenge::RVNGBinaryData(data, size);
+  }
+}
+
+ImageStore::Image::Image()
+  : m_type(UNKNOWN)
+  , m_delayed(false)
+  , m_offset(0)
+  , m_length(0)
+  , m_decodedSize(0)
+  , m_data()
+  , m_loaded(false)
+  , m_uses(0)
+{
+}
+
+ImageStore::ImageStore()
+  : m_images()
+  , m_streamData()
+  , m_stream()
+  , m_noData()
+  , m_mutex()
+{
+}
+
+ImageStore::~ImageStore()
+{
+}
+
+void ImageStore::setStream(std::unique_ptr<librevenge::RVNGInputStream> stream)
+{
+  m_stream = std::move(stream);
+  m_streamData.clear();
+}
+
+void ImageStore::copyStream()
+{
+  if (!m_stream || !m_streamData.empty())
+    return;
+  const unsigned long length = getLength(m_stream.get());
+  m_stream->seek(0, librevenge::RVNG_SEEK_SET);
+  readNBytes(m_stream.get(), length, m_streamData);
+  m_stream.reset(new MemoryStream(m_streamData.data(), m_streamData.size()));
+}
+
+ImageStore::Image &ImageStore::getImage(const unsigned index)
+{
+  if (m_images.size() < index)
+    m_images.resize(index);
+  return m_images[index - 1];
+}
+
+void ImageStore::addImage(const unsigned index, const ImgType type, const librevenge::RVNGBinaryData &img)
+{
+  if (index == 0)
+    return;
+  Image &image = getImage(index);
+  image = Image();
+  image.m_type = type;
+  image.m_data = img;
+  image.m_loaded = true;
+}
+
+void ImageStore::addDelayedImage(const unsigned index, const ImgType type, const unsigned long offset, const unsigned long length, const unsigned long decodedSize)
+{
+  if (index == 0)
+    return;
+  Image &image = getImage(index);
+  image = Image();
+  image.m_type = type;
+  image.m_delayed = true;
+  image.m_offset = offset;
+  image.m_length = length;
+  image.m_decodedSize = decodedSize;
+}
+
+bool ImageStore::hasImage(const unsigned index) const
+{
+  return index > 0 && index <= m_images.size();
+}
+
+ImgType ImageStore::getType(const unsigned index) const
+{
+  return hasImage(index) ? m_images[index - 1].m_type : UNKNOWN;
+}
+
+const librevenge::RVNGBinaryData &ImageStore::getData(const unsigned index) const
+{
+  if (!hasImage(index))
+    return m_noData;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const Image &image = m_images[index - 1];
+  if (!image.m_loaded)
+  {
+    image.m_loaded = true;
+    if (image.m_delayed && m_stream)
+    {
+      // Decode straight from the stream's buffer; streams that return
+      // the data in pieces need it gathered first.
+      m_stream->seek(long(image.m_offset), librevenge::RVNG_SEEK_SET);
+      unsigned long size = 0;
+      const unsigned char *data = m_stream->read(image.m_length, size);
+      librevenge::RVNGBinaryData gathered;
+      if (size < image.m_length && !m_stream->isEnd())
+      {
+        gathered.append(data, size);
+        readBinaryData(m_stream.get(), image.m_length - size, gathered);
+        data = gathered.getDataBuffer();
+        size = gathered.size();
+      }
+      image.m_data = decodeImage(image.m_type, data, size, image.m_decodedSize);
+    }
+  }
+  return image.m_data;
+}
+
+void ImageStore::decodeImages(const std::vector<unsigned> &indices, const unsigned threadCount) const
+{
+  if (!m_stream)
+    return;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<unsigned> pending;
+  for (unsigned index : indices)
+  {
+    if (!hasImage(index))
+      continue;
+    const Image &image = m_images[index - 1];
+    if (image.m_delayed && !image.m_loaded && (image.m_type == WMF || image.m_type == EMF))
+      pending.push_back(index);
+  }
+  std::sort(pending.begin(), pending.end());
+  pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+  if (pending.empty())
+    return;
+
+  std::vector<librevenge::RVNGBinaryData> compressed(pending.size());
+  for (std::size_t i = 0; i < pending.size(); ++i)
+  {
+    const Image &image = m_images[pending[i] - 1];
+    m_stream->seek(long(image.m_offset), librevenge::RVNG_SEEK_SET);
+    readBinaryData(m_stream.get(), image.m_length, compressed[i]);
+  }
+  std::vector<librevenge::RVNGBinaryData> decoded(pending.size());
+  runTasks(pending.size(), threadCount, [&](std::size_t i)
+  {
+    const Image &image = m_images[pending[i] - 1];
+    decoded[i] = decodeImage(image.m_type, compressed[i].getDataBuffer(), compressed[i].size(), image.m_decodedSize);
+  });
+  for (std::size_t i = 0; i < pending.size(); ++i)
+  {
+    const Image &image = m_images[pending[i] - 1];
+    image.m_data = decoded[i];
+    image.m_loaded = true;
+  }
+}
+
+void ImageStore::addUse(const unsigned index)
+{
+  if (hasImage(index))
+    ++m_images[index - 1].m_uses;
+}
+
+void ImageStore::releaseUse(const unsigned index) const
+{
+  if (!hasImage(index))
+    return;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const Image &image = m_images[index - 1];
+  if (image.m_uses == 0)
+    return;
+  if (--image.m_uses == 0 && image.m_delayed)
+  {
+    image.m_data.clear();
+    image.m_loaded = false;
+  }
+}
+
+void ImageStore::clearUses()
+{
+  for (auto &image : m_images)
+    image.m_uses = 0;
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
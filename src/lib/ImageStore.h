@@ -0,0 +1,107 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_IMAGESTORE_H
+#define INCLUDED_IMAGESTORE_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <librevenge/librevenge.h>
+#include <librevenge-stream/librevenge-stream.h>
+
+#include "MSPUBTypes.h"
+
+namespace libmspub
+{
+
+/** Images of a document, indexed from 1 like the BStore.
+ *
+ * Images can be added with their data, or as a reference to a blip in
+ * an owned stream (the EscherDelayStm). Referenced images are read and
+ * decoded when they are first requested, and the decoded data is dropped
+ * again once all the announced uses of the image are done, so only the
+ * images that are actually drawn are ever held in memory.
+ *
+ * The const members may be called from several threads at once.
+ */
+class ImageStore
+{
+public:
+  ImageStore();
+  ~ImageStore();
+
+  /// Sets the stream that delayed images are read from.
+  void setStream(std::unique_ptr<librevenge::RVNGInputStream> stream);
+  /// Replaces the stream by a copy of its contents, so the store no longer depends on where the stream came from.
+  void copyStream();
+
+  void addImage(unsigned index, ImgType type, const librevenge::RVNGBinaryData &img);
+  /** Adds an image whose data is @c length bytes at @c offset in the stream.
+    *
+    * For compressed metafiles, @c decodedSize is the size given in the
+    * blip header, or 0 if it is not known.
+    */
+  void addDelayedImage(unsigned index, ImgType type, unsigned long offset, unsigned long length, unsigned long decodedSize);
+
+  bool hasImage(unsigned index) const;
+  ImgType getType(unsigned index) const;
+  /// Returns the decoded data of an image, reading it first if necessary.
+  const librevenge::RVNGBinaryData &getData(unsigned index) const;
+  /** Decodes the compressed metafiles among the given images on up to threadCount threads.
+    *
+    * The images are read from the stream on the calling thread; only the
+    * inflation runs concurrently.
+    */
+  void decodeImages(const std::vector<unsigned> &indices, unsigned threadCount) const;
+
+  /// Announces one more use of an image.
+  void addUse(unsigned index);
+  /// Marks one use of an image as done; the data of a delayed image is dropped after its last use.
+  void releaseUse(unsigned index) const;
+  void clearUses();
+
+private:
+  ImageStore(const ImageStore &);
+  ImageStore &operator=(const ImageStore &);
+
+  struct Image
+  {
+    Image();
+
+    ImgType m_type;
+    bool m_delayed;
+    unsigned long m_offset;
+    unsigned long m_length;
+    unsigned long m_decodedSize;
+    mutable librevenge::RVNGBinaryData m_data;
+    mutable bool m_loaded;
+    mutable unsigned m_uses;
+  };
+
+  Image &getImage(unsigned index);
+
+  std::vector<Image> m_images;
+  // the contents of the stream, once copyStream() has been called
+  std::vector<unsigned char> m_streamData;
+  std::unique_ptr<librevenge::RVNGInputStream> m_stream;
+  // returned for missing images; per store, as copies of it share its data
+  const librevenge::RVNGBinaryData m_noData;
+  // guards the stream and the mutable parts of the images
+  mutable std::mutex m_mutex;
+};
+
+/// Turns a blip as stored in the file into data usable by a consumer.
+librevenge::RVNGBinaryData decodeImage(ImgType type, const unsigned char *data, unsigned long size, unsigned long decodedSize = 0);
+
+}
+
+#endif // INCLUDED_IMAGESTORE_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
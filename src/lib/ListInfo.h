@@ -10,6 +10,8 @@
 #ifndef INCLUDED_LISTINFO_H
 #define INCLUDED_LISTINFO_H
 
+#include <tuple>
+
 #include <boost/optional.hpp>
 
 #include "NumberingDelimiter.h"
@@ -46,6 +48,12 @@ struct ListInfo
   {
   }
 };
+
+inline bool operator<(const ListInfo &lhs, const ListInfo &rhs)
+{
+  return std::tie(lhs.m_listType, lhs.m_bulletChar, lhs.m_numberIfRestarted, lhs.m_numberingType, lhs.m_numberingDelimiter)
+         < std::tie(rhs.m_listType, rhs.m_bulletChar, rhs.m_numberIfRestarted, rhs.m_numberingType, rhs.m_numberingDelimiter);
+}
 } // namespace libmspub
 
 #endif /* INCLUDED_LISTINFO_H */
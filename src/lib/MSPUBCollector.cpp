@@ -10,12 +10,12 @@
 #include "MSPUBCollector.h"
 
 #include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <functional>
 #include <math.h>
 #include <memory>
 
-#include <boost/multi_array.hpp>
-
 #include <unicode/ucsdet.h>
 #include <unicode/uloc.h>
 
@@ -28,10 +28,13 @@
 #include "MSPUBConstants.h"
 #include "MSPUBTypes.h"
 #include "PolygonUtils.h"
+#include "RecordingPainter.h"
 #include "Shadow.h"
 #include "ShapeGroupElement.h"
 #include "TableInfo.h"
+#include "TextInsertion.h"
 #include "VectorTransformation2D.h"
+#include "WorkerPool.h"
 #include "libmspub_utils.h"
 
 namespace libmspub
@@ -42,112 +45,20 @@ using namespace std::placeholders;
 namespace
 {
 
-static void separateTabsAndInsertText(librevenge::RVNGDrawingInterface *iface, const librevenge::RVNGString &text)
-{
-  if (!iface || text.empty())
-    return;
-  librevenge::RVNGString tmpText;
-  librevenge::RVNGString::Iter i(text);
-  for (i.rewind(); i.next();)
-  {
-    if (*(i()) == '\t')
-    {
-      if (!tmpText.empty())
-      {
-        if (iface)
-          iface->insertText(tmpText);
-        tmpText.clear();
-      }
-
-      if (iface)
-        iface->insertTab();
-    }
-    else if (*(i()) == '\n')
-    {
-      if (!tmpText.empty())
-      {
-        if (iface)
-          iface->insertText(tmpText);
-        tmpText.clear();
-      }
-
-      if (iface)
-        iface->insertLineBreak();
-    }
-    else
-    {
-      tmpText.append(i());
-    }
-  }
-  if (iface && !tmpText.empty())
-    iface->insertText(tmpText);
-}
-
-static void separateSpacesAndInsertText(librevenge::RVNGDrawingInterface *iface, const librevenge::RVNGString &text)
-{
-  if (!iface)
-    return;
-  if (text.empty())
-  {
-    iface->insertText(text);
-    return;
-  }
-  librevenge::RVNGString tmpText;
-  int numConsecutiveSpaces = 0;
-  librevenge::RVNGString::Iter i(text);
-  for (i.rewind(); i.next();)
-  {
-    if (*(i()) == ' ')
-      numConsecutiveSpaces++;
-    else
-      numConsecutiveSpaces = 0;
-
-    if (numConsecutiveSpaces > 1)
-    {
-      if (!tmpText.empty())
-      {
-        separateTabsAndInsertText(iface, tmpText);
-        tmpText.clear();
-      }
-
-      if (iface)
-        iface->insertSpace();
-    }
-    else
-    {
-      tmpText.append(i());
-    }
-  }
-  separateTabsAndInsertText(iface, tmpText);
-}
-
-struct TableLayoutCell
-{
-  TableLayoutCell()
-    : m_cell(0)
-    , m_rowSpan(0)
-    , m_colSpan(0)
-  {
-  }
-
-  unsigned m_cell;
-  unsigned m_rowSpan;
-  unsigned m_colSpan;
-};
-
 bool isCovered(const TableLayoutCell &cell)
 {
   assert((cell.m_rowSpan == 0) == (cell.m_colSpan == 0));
   return (cell.m_rowSpan == 0) && (cell.m_colSpan == 0);
 }
 
-typedef boost::multi_array<TableLayoutCell, 2> TableLayout;
-
-void createTableLayout(const std::vector<CellInfo> &cells, TableLayout &tableLayout)
+void createTableLayout(TableInfo &tableInfo)
 {
+  const std::vector<CellInfo> &cells = tableInfo.m_cells;
+  std::vector<TableLayoutCell> &tableLayout = tableInfo.m_layout;
+  tableLayout.assign(std::size_t(tableInfo.m_numRows) * tableInfo.m_numColumns, TableLayoutCell());
   for (auto it = cells.begin(); it != cells.end(); ++it)
   {
-    if ((it->m_endRow >= tableLayout.shape()[0]) || (it->m_endColumn >= tableLayout.shape()[1]))
+    if ((it->m_endRow >= tableInfo.m_numRows) || (it->m_endColumn >= tableInfo.m_numColumns))
     {
       MSPUB_DEBUG_MSG((
                         "cell %u (rows %u to %u, columns %u to %u) overflows the table, ignoring\n",
@@ -190,67 +101,13 @@ void createTableLayout(const std::vector<CellInfo> &cells, TableLayout &tableLay
       continue;
     }
 
-    TableLayoutCell &layoutCell = tableLayout[it->m_startRow][it->m_startColumn];
+    TableLayoutCell &layoutCell = tableLayout[std::size_t(it->m_startRow) * tableInfo.m_numColumns + it->m_startColumn];
     layoutCell.m_cell = unsigned(int(it - cells.begin()));
     layoutCell.m_rowSpan = rowSpan;
     layoutCell.m_colSpan = colSpan;
   }
 }
 
-typedef std::vector<std::pair<unsigned, unsigned> > ParagraphToCellMap_t;
-typedef std::vector<librevenge::RVNGString> SpanTexts_t;
-typedef std::vector<SpanTexts_t> ParagraphTexts_t;
-
-void mapTableTextToCells(
-  const std::vector<TextParagraph> &text,
-  const std::vector<unsigned> &tableCellTextEnds,
-  const char *const encoding,
-  ParagraphToCellMap_t &paraToCellMap,
-  ParagraphTexts_t &paraTexts
-)
-{
-  assert(paraToCellMap.empty());
-  assert(paraTexts.empty());
-
-  paraToCellMap.reserve(tableCellTextEnds.size());
-  paraTexts.reserve(tableCellTextEnds.size());
-
-  unsigned firstPara = 0;
-  unsigned offset = 1;
-  for (unsigned para = 0; para != text.size() && paraToCellMap.size() < tableCellTextEnds.size(); ++para)
-  {
-    paraTexts.push_back(SpanTexts_t());
-    paraTexts.back().reserve(text[para].spans.size());
-
-    for (unsigned i_spans = 0; i_spans != text[para].spans.size(); ++i_spans)
-    {
-      librevenge::RVNGString textString;
-      appendCharacters(textString, text[para].spans[i_spans].chars, encoding);
-      offset += textString.len();
-      // TODO: why do we not drop these during parse already?
-      if ((i_spans == text[para].spans.size() - 1) && (textString == "\r"))
-        continue;
-      paraTexts.back().push_back(textString);
-    }
-
-    assert(paraTexts.back().size() <= text[para].spans.size());
-
-    if (offset >= tableCellTextEnds[paraToCellMap.size()])
-    {
-      if (offset > tableCellTextEnds[paraToCellMap.size()])
-      {
-        MSPUB_DEBUG_MSG(("text of cell %u ends in the middle of a paragraph!\n", unsigned(paraToCellMap.size())));
-      }
-
-      paraToCellMap.push_back(std::make_pair(firstPara, para));
-      firstPara = para + 1;
-    }
-  }
-
-  assert(paraTexts.size() == text.size());
-  assert(paraToCellMap.size() <= tableCellTextEnds.size());
-}
-
 void fillUnderline(librevenge::RVNGPropertyList &props, const Underline underline)
 {
   switch (underline)
@@ -397,7 +254,9 @@ void MSPUBCollector::setShapeEndArrow(unsigned seqNum,
 void MSPUBCollector::setShapeTableInfo(unsigned seqNum,
                                        const TableInfo &ti)
 {
-  m_shapeInfosBySeqNum[seqNum].m_tableInfo = ti;
+  boost::optional<TableInfo> &tableInfo = m_shapeInfosBySeqNum[seqNum].m_tableInfo;
+  tableInfo = ti;
+  createTableLayout(get(tableInfo));
 }
 
 void MSPUBCollector::setShapeNumColumns(unsigned seqNum,
@@ -479,10 +338,11 @@ void MSPUBCollector::setNextPage(unsigned pageSeqNum)
 MSPUBCollector::MSPUBCollector(librevenge::RVNGDrawingInterface *painter) :
   m_painter(painter), m_contentChunkReferences(), m_width(0), m_height(0),
   m_widthSet(false), m_heightSet(false),
-  m_numPages(0), m_textStringsById(), m_pagesBySeqNum(),
+  m_numPages(0), m_textBuffer(), m_textSpans(), m_textParagraphs(), m_textStringsById(), m_decodedTextSpans(), m_pagesBySeqNum(),
   m_images(), m_borderImages(),
   m_textColors(), m_fonts(),
-  m_defaultCharStyles(), m_defaultParaStyles(), m_shapeTypesBySeqNum(),
+  m_defaultCharStyles(), m_defaultParaStyles(),
+  m_charStyles(), m_charStyleIds(), m_paraStyles(), m_paraStyleIds(), m_shapeTypesBySeqNum(),
   m_paletteColors(), m_shapeSeqNumsOrdered(),
   m_pageSeqNumsByShapeSeqNum(), m_bgShapeSeqNumsByPageSeqNum(),
   m_skipIfNotBgSeqNums(),
@@ -491,14 +351,33 @@ MSPUBCollector::MSPUBCollector(librevenge::RVNGDrawingInterface *painter) :
   m_shapeInfosBySeqNum(), m_masterPages(),
   m_shapesWithCoordinatesRotated90(),
   m_masterPagesByPageSeqNum(),
-  m_tableCellTextEndsByTextId(), m_stringOffsetsByTextId(),
-  m_calculationValuesSeen(), m_pageSeqNumsOrdered(),
-  m_encodingHeuristic(false), m_allText(),
-  m_calculatedEncoding(),
+  m_tableCellTextEndsByTextId(), m_tableTextsByTextId(), m_stringOffsetsByTextId(),
+  m_pageSeqNumsOrdered(),
+  m_encodingHeuristic(false),
+  m_calculatedEncoding(), m_threadCount(1), m_isPageSelected(), m_stylePropsCacheMutex(), m_charStylePropsCache(), m_paraStylePropsCache(),
   m_metaData()
 {
 }
 
+void MSPUBCollector::mergeText(MSPUBCollector &other)
+{
+  assert(m_textStringsById.empty() && m_charStyles.empty() && m_paraStyles.empty() && m_fonts.empty());
+  m_textBuffer = std::move(other.m_textBuffer);
+  m_textSpans = std::move(other.m_textSpans);
+  m_textParagraphs = std::move(other.m_textParagraphs);
+  m_textStringsById = std::move(other.m_textStringsById);
+  m_stringOffsetsByTextId = std::move(other.m_stringOffsetsByTextId);
+  m_tableCellTextEndsByTextId = std::move(other.m_tableCellTextEndsByTextId);
+  m_textColors = std::move(other.m_textColors);
+  m_fonts = std::move(other.m_fonts);
+  m_defaultCharStyles = std::move(other.m_defaultCharStyles);
+  m_defaultParaStyles = std::move(other.m_defaultParaStyles);
+  m_charStyles = std::move(other.m_charStyles);
+  m_charStyleIds = std::move(other.m_charStyleIds);
+  m_paraStyles = std::move(other.m_paraStyles);
+  m_paraStyleIds = std::move(other.m_paraStyleIds);
+}
+
 void MSPUBCollector::setTextStringOffset(
   unsigned textId, unsigned offset)
 {
@@ -649,18 +528,66 @@ std::vector<int> MSPUBCollector::getShapeAdjustValues(const ShapeInfo &info) con
   return ret;
 }
 
-boost::optional<std::vector<TextParagraph> > MSPUBCollector::getShapeText(const ShapeInfo &info) const
+const TextStringRecord *MSPUBCollector::getShapeText(const ShapeInfo &info) const
 {
   if (bool(info.m_textId))
+    return getIfExists_const(m_textStringsById, info.m_textId.get());
+  return nullptr;
+}
+
+void MSPUBCollector::decodeTextStrings()
+{
+  const char *const encoding = getCalculatedEncoding();
+  m_decodedTextSpans.clear();
+  m_decodedTextSpans.reserve(m_textSpans.size());
+  for (const auto &span : m_textSpans)
+  {
+    m_decodedTextSpans.push_back(librevenge::RVNGString());
+    appendCharacters(m_decodedTextSpans.back(), m_textBuffer.data() + span.m_offset, span.m_length, encoding);
+  }
+}
+
+void MSPUBCollector::setupTableTexts()
+{
+  m_tableTextsByTextId.clear();
+  for (const auto &cellTextEnds : m_tableCellTextEndsByTextId)
   {
-    unsigned stringId = info.m_textId.get();
-    const std::vector<TextParagraph> *ptr_str = getIfExists_const(m_textStringsById, stringId);
-    if (ptr_str)
+    const TextStringRecord *const record = getIfExists_const(m_textStringsById, cellTextEnds.first);
+    if (!record)
+      continue;
+    const std::vector<unsigned> &tableCellTextEnds = cellTextEnds.second;
+    const TextParagraphRecord *const text = m_textParagraphs.data() + record->m_firstParagraph;
+    TableText &tableText = m_tableTextsByTextId[cellTextEnds.first];
+    tableText.m_cellParagraphs.reserve(tableCellTextEnds.size());
+    tableText.m_paragraphSpanCounts.reserve(record->m_paragraphCount);
+
+    unsigned firstPara = 0;
+    unsigned offset = 1;
+    for (unsigned para = 0; para != record->m_paragraphCount && tableText.m_cellParagraphs.size() < tableCellTextEnds.size(); ++para)
     {
-      return *ptr_str;
+      unsigned spanCount = text[para].m_spanCount;
+      for (unsigned i_spans = 0; i_spans != text[para].m_spanCount; ++i_spans)
+      {
+        const librevenge::RVNGString &textString = m_decodedTextSpans[text[para].m_firstSpan + i_spans];
+        offset += textString.len();
+        // TODO: why do we not drop these during parse already?
+        if ((i_spans == text[para].m_spanCount - 1) && (textString == "\r"))
+          --spanCount;
+      }
+      tableText.m_paragraphSpanCounts.push_back(spanCount);
+
+      if (offset >= tableCellTextEnds[tableText.m_cellParagraphs.size()])
+      {
+        if (offset > tableCellTextEnds[tableText.m_cellParagraphs.size()])
+        {
+          MSPUB_DEBUG_MSG(("text of cell %u ends in the middle of a paragraph!\n", unsigned(tableText.m_cellParagraphs.size())));
+        }
+
+        tableText.m_cellParagraphs.push_back(std::make_pair(firstPara, para));
+        firstPara = para + 1;
+      }
     }
   }
-  return boost::optional<std::vector<TextParagraph> >();
 }
 
 void MSPUBCollector::setupShapeStructures(ShapeGroupElement &elt)
@@ -674,7 +601,7 @@ void MSPUBCollector::setupShapeStructures(ShapeGroupElement &elt)
       int rot = 0;
       if (bool(ptr_info->m_innerRotation))
         rot = ptr_info->m_innerRotation.get();
-      if (index - 1 < m_images.size())
+      if (m_images.hasImage(index))
       {
         ptr_info->m_fill = std::shared_ptr<const Fill>(new ImgFill(index, this, false, rot));
       }
@@ -691,14 +618,38 @@ void MSPUBCollector::setupShapeStructures(ShapeGroupElement &elt)
 }
 
 
-std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, const Coordinate &/* relativeTo*/, const VectorTransformation2D &foldedTransform, bool isGroup, const VectorTransformation2D &thisTransform) const
+void MSPUBCollector::encodeBorderImages()
+{
+  for (auto &ba : m_borderImages)
+  {
+    for (auto &bi : ba.m_images)
+    {
+      bi.m_tileProps.clear();
+      bi.m_tileProps.insert("librevenge:mime-type", mimeByImgType(bi.m_type));
+      bi.m_tileProps.insert("office:binary-data", bi.m_imgBlob);
+    }
+    ba.m_offsetImages.clear();
+    ba.m_offsetImages.reserve(ba.m_offsets.size());
+    for (unsigned offset : ba.m_offsets)
+    {
+      const auto it = std::lower_bound(ba.m_offsetsOrdered.begin(), ba.m_offsetsOrdered.end(), offset);
+      ba.m_offsetImages.push_back(unsigned(it - ba.m_offsetsOrdered.begin()));
+    }
+  }
+}
+
+std::function<void(void)> MSPUBCollector::paintShape(librevenge::RVNGDrawingInterface *painter, const ShapeInfo &info, const Coordinate &/* relativeTo*/, const VectorTransformation2D &foldedTransform, bool isGroup, const VectorTransformation2D &thisTransform) const
 {
   std::vector<int> adjustValues = getShapeAdjustValues(info);
   if (isGroup)
   {
-    m_painter->startLayer(librevenge::RVNGPropertyList());
-    return std::bind(&endShapeGroup, m_painter);
+    painter->startLayer(librevenge::RVNGPropertyList());
+    return std::bind(&endShapeGroup, painter);
   }
+  const auto calculator = [this, &info, &adjustValues](unsigned index)
+  {
+    return getCalculationValue(info, index, adjustValues);
+  };
   librevenge::RVNGPropertyList graphicsProps;
   if (info.m_fill)
   {
@@ -725,7 +676,7 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
   }
   librevenge::RVNGString fill = graphicsProps["draw:fill"] ? graphicsProps["draw:fill"]->getStr() : "none";
   bool hasFill = fill != "none";
-  boost::optional<std::vector<TextParagraph> > maybeText = getShapeText(info);
+  const TextStringRecord *const maybeText = getShapeText(info);
   auto hasText = bool(maybeText);
   const auto isTable = bool(info.m_tableInfo);
   bool makeLayer = hasBorderArt ||
@@ -740,10 +691,10 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
       y = coord.getYIn(m_height);
       height = coord.getHeightIn();
       width = coord.getWidthIn();
-      m_painter->startLayer(calcClipPath(info.m_clipPath, x, y, height, width, foldedTransform, info.getCustomShape()));
+      painter->startLayer(calcClipPath(info.m_clipPath, x, y, height, width, foldedTransform, info.getCustomShape()));
     }
     else
-      m_painter->startLayer(librevenge::RVNGPropertyList());
+      painter->startLayer(librevenge::RVNGPropertyList());
   }
   graphicsProps.insert("draw:stroke", "none");
   const Coordinate coord = info.m_coordinates.get_value_or(Coordinate());
@@ -807,11 +758,11 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
       // TODO: Emulate shadows that don't conform
       // to LibreOffice's range of possible shadows.
     }
-    m_painter->setStyle(graphicsProps);
+    painter->setStyle(graphicsProps);
 
-    writeCustomShape(type, graphicsProps, m_painter, x, y, height, width,
+    writeCustomShape(type, graphicsProps, painter, x, y, height, width,
                      true, foldedTransform,
-                     std::vector<Line>(), std::bind(&MSPUBCollector::getCalculationValue, this, info, _1, false, adjustValues), m_paletteColors, info.getCustomShape());
+                     std::vector<Line>(), calculator, m_paletteColors, info.getCustomShape());
     if (bool(info.m_pictureRecolor))
     {
       graphicsProps.remove("draw:color-mode");
@@ -866,175 +817,129 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
         if (maybeBorderImg.get() < m_borderImages.size())
         {
           const BorderArtInfo &ba = m_borderImages[maybeBorderImg.get()];
-          if (!ba.m_offsets.empty())
+          if (!ba.m_offsetImages.empty())
           {
             librevenge::RVNGPropertyList baProps;
             baProps.insert("draw:stroke", "none");
             baProps.insert("draw:fill", "solid");
             baProps.insert("draw:fill-color", "#ffffff");
-            m_painter->setStyle(baProps);
+            painter->setStyle(baProps);
             librevenge::RVNGPropertyList topRectProps;
             topRectProps.insert("svg:x", x);
             topRectProps.insert("svg:y", y);
             topRectProps.insert("svg:height", borderImgWidth);
             topRectProps.insert("svg:width", width);
-            m_painter->drawRectangle(topRectProps);
+            painter->drawRectangle(topRectProps);
             librevenge::RVNGPropertyList rightRectProps;
             rightRectProps.insert("svg:x", x + width - borderImgWidth);
             rightRectProps.insert("svg:y", y);
             rightRectProps.insert("svg:height", height);
             rightRectProps.insert("svg:width", borderImgWidth);
-            m_painter->drawRectangle(rightRectProps);
+            painter->drawRectangle(rightRectProps);
             librevenge::RVNGPropertyList botRectProps;
             botRectProps.insert("svg:x", x);
             botRectProps.insert("svg:y", y + height - borderImgWidth);
             botRectProps.insert("svg:height", borderImgWidth);
             botRectProps.insert("svg:width", width);
-            m_painter->drawRectangle(botRectProps);
+            painter->drawRectangle(botRectProps);
             librevenge::RVNGPropertyList leftRectProps;
             leftRectProps.insert("svg:x", x);
             leftRectProps.insert("svg:y", y);
             leftRectProps.insert("svg:height", height);
             leftRectProps.insert("svg:width", borderImgWidth);
-            m_painter->drawRectangle(leftRectProps);
-            auto iOffset = ba.m_offsets.begin();
+            painter->drawRectangle(leftRectProps);
             boost::optional<Color> oneBitColor;
             if (bool(info.m_lineBackColor))
             {
               oneBitColor = info.m_lineBackColor.get().getFinalColor(m_paletteColors);
             }
-            // top left
-            unsigned iOrdOff = find(ba.m_offsetsOrdered.begin(),
-                                    ba.m_offsetsOrdered.end(), *iOffset) - ba.m_offsetsOrdered.begin();
-            if (iOrdOff < ba.m_images.size())
+            // The tiles are listed clockwise from the top left corner; the
+            // last one is reused for any position past the end of the list.
+            auto tileImage = [&ba](unsigned position) -> const BorderImgInfo *
             {
-              const BorderImgInfo &bi = ba.m_images[iOrdOff];
-              writeImage(x, y, borderImgWidth, borderImgWidth,
-                         bi.m_type, bi.m_imgBlob, oneBitColor);
-            }
-            if (iOffset + 1 != ba.m_offsets.end())
+              const unsigned index = ba.m_offsetImages[std::min<std::size_t>(position, ba.m_offsetImages.size() - 1)];
+              return index < ba.m_images.size() ? &ba.m_images[index] : nullptr;
+            };
+            // top left
+            if (const BorderImgInfo *const bi = tileImage(0))
             {
-              ++iOffset;
+              writeImage(painter, x, y, borderImgWidth, borderImgWidth,
+                         bi->m_tileProps, oneBitColor);
             }
             // top
-            iOrdOff = find(ba.m_offsetsOrdered.begin(),
-                           ba.m_offsetsOrdered.end(), *iOffset) - ba.m_offsetsOrdered.begin();
-            if (iOrdOff < ba.m_images.size())
+            if (const BorderImgInfo *const bi = tileImage(1))
             {
-              const BorderImgInfo &bi = ba.m_images[iOrdOff];
               for (unsigned iTop = 1; iTop < numImagesHoriz - 1; ++iTop)
               {
                 double imgX = stretch ?
                               x + borderImgWidth + (iTop - 1) * stretchedImgWidth :
                               x + iTop * (borderImgWidth + borderHorizPadding);
-                writeImage(imgX, y,
+                writeImage(painter, imgX, y,
                            borderImgWidth, stretchedImgWidth,
-                           bi.m_type, bi.m_imgBlob, oneBitColor);
+                           bi->m_tileProps, oneBitColor);
               }
             }
-            if (iOffset + 1 != ba.m_offsets.end())
-            {
-              ++iOffset;
-            }
             // top right
-            iOrdOff = find(ba.m_offsetsOrdered.begin(),
-                           ba.m_offsetsOrdered.end(), *iOffset) - ba.m_offsetsOrdered.begin();
-            if (iOrdOff < ba.m_images.size())
+            if (const BorderImgInfo *const bi = tileImage(2))
             {
-              const BorderImgInfo &bi = ba.m_images[iOrdOff];
-              writeImage(x + width - borderImgWidth, y,
+              writeImage(painter, x + width - borderImgWidth, y,
                          borderImgWidth, borderImgWidth,
-                         bi.m_type, bi.m_imgBlob, oneBitColor);
-            }
-            if (iOffset + 1 != ba.m_offsets.end())
-            {
-              ++iOffset;
+                         bi->m_tileProps, oneBitColor);
             }
             // right
-            iOrdOff = find(ba.m_offsetsOrdered.begin(),
-                           ba.m_offsetsOrdered.end(), *iOffset) - ba.m_offsetsOrdered.begin();
-            if (iOrdOff < ba.m_images.size())
+            if (const BorderImgInfo *const bi = tileImage(3))
             {
-              const BorderImgInfo &bi = ba.m_images[iOrdOff];
               for (unsigned iRight = 1; iRight < numImagesVert - 1; ++iRight)
               {
                 double imgY = stretch ?
                               y + borderImgWidth + (iRight - 1) * stretchedImgHeight :
                               y + iRight * (borderImgWidth + borderVertPadding);
-                writeImage(x + width - borderImgWidth,
+                writeImage(painter, x + width - borderImgWidth,
                            imgY,
                            stretchedImgHeight, borderImgWidth,
-                           bi.m_type, bi.m_imgBlob, oneBitColor);
+                           bi->m_tileProps, oneBitColor);
               }
             }
-            if (iOffset + 1 != ba.m_offsets.end())
-            {
-              ++iOffset;
-            }
             // bottom right
-            iOrdOff = find(ba.m_offsetsOrdered.begin(),
-                           ba.m_offsetsOrdered.end(), *iOffset) - ba.m_offsetsOrdered.begin();
-            if (iOrdOff < ba.m_images.size())
+            if (const BorderImgInfo *const bi = tileImage(4))
             {
-              const BorderImgInfo &bi = ba.m_images[iOrdOff];
-              writeImage(x + width - borderImgWidth,
+              writeImage(painter, x + width - borderImgWidth,
                          y + height - borderImgWidth,
                          borderImgWidth, borderImgWidth,
-                         bi.m_type, bi.m_imgBlob, oneBitColor);
-            }
-            if (iOffset + 1 != ba.m_offsets.end())
-            {
-              ++iOffset;
+                         bi->m_tileProps, oneBitColor);
             }
             // bottom
-            iOrdOff = find(ba.m_offsetsOrdered.begin(),
-                           ba.m_offsetsOrdered.end(), *iOffset) - ba.m_offsetsOrdered.begin();
-            if (iOrdOff < ba.m_images.size())
+            if (const BorderImgInfo *const bi = tileImage(5))
             {
-              const BorderImgInfo &bi = ba.m_images[iOrdOff];
               for (unsigned iBot = 1; iBot < numImagesHoriz - 1; ++iBot)
               {
                 double imgX = stretch ?
                               x + width - borderImgWidth - iBot * stretchedImgWidth :
                               x + width - borderImgWidth - iBot * (borderImgWidth + borderHorizPadding);
-                writeImage(
+                writeImage(painter,
                   imgX, y + height - borderImgWidth,
                   borderImgWidth, stretchedImgWidth,
-                  bi.m_type, bi.m_imgBlob, oneBitColor);
+                  bi->m_tileProps, oneBitColor);
               }
             }
-            if (iOffset + 1 != ba.m_offsets.end())
-            {
-              ++iOffset;
-            }
             // bottom left
-            iOrdOff = find(ba.m_offsetsOrdered.begin(),
-                           ba.m_offsetsOrdered.end(), *iOffset) - ba.m_offsetsOrdered.begin();
-            if (iOrdOff < ba.m_images.size())
+            if (const BorderImgInfo *const bi = tileImage(6))
             {
-              const BorderImgInfo &bi = ba.m_images[iOrdOff];
-              writeImage(x, y + height - borderImgWidth,
+              writeImage(painter, x, y + height - borderImgWidth,
                          borderImgWidth, borderImgWidth,
-                         bi.m_type, bi.m_imgBlob, oneBitColor);
-            }
-            if (iOffset + 1 != ba.m_offsets.end())
-            {
-              ++iOffset;
+                         bi->m_tileProps, oneBitColor);
             }
             // left
-            iOrdOff = find(ba.m_offsetsOrdered.begin(),
-                           ba.m_offsetsOrdered.end(), *iOffset) - ba.m_offsetsOrdered.begin();
-            if (iOrdOff < ba.m_images.size())
+            if (const BorderImgInfo *const bi = tileImage(7))
             {
-              const BorderImgInfo &bi = ba.m_images[iOrdOff];
               for (unsigned iLeft = 1; iLeft < numImagesVert - 1; ++iLeft)
               {
                 double imgY = stretch ?
                               y + height - borderImgWidth - iLeft * stretchedImgHeight :
                               y + height - borderImgWidth -
                               iLeft * (borderImgWidth + borderVertPadding);
-                writeImage(x, imgY, stretchedImgHeight, borderImgWidth,
-                           bi.m_type, bi.m_imgBlob, oneBitColor);
+                writeImage(painter, x, imgY, stretchedImgHeight, borderImgWidth,
+                           bi->m_tileProps, oneBitColor);
               }
             }
           }
@@ -1084,22 +989,19 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
       {
         graphicsProps.insert("draw:stroke", "solid");
       }
-      m_painter->setStyle(graphicsProps);
-      writeCustomShape(type, graphicsProps, m_painter, x, y, height, width,
-                       false, foldedTransform, lines,
-                       std::bind(
-                         &MSPUBCollector::getCalculationValue, this, info, _1, false, adjustValues
-                       ),
+      painter->setStyle(graphicsProps);
+      writeCustomShape(type, graphicsProps, painter, x, y, height, width,
+                       false, foldedTransform, lines, calculator,
                        m_paletteColors, info.getCustomShape());
     }
   }
   if (hasText)
   {
-    const std::vector<TextParagraph> &text = maybeText.get();
+    const TextParagraphRecord *const text = m_textParagraphs.data() + maybeText->m_firstParagraph;
     graphicsProps.insert("draw:fill", "none");
     Coordinate textCoord = isShapeTypeRectangle(type) ?
                            getFudgedCoordinates(coord, lines, false, borderPosition) : coord;
-    m_painter->setStyle(graphicsProps);
+    painter->setStyle(graphicsProps);
     librevenge::RVNGPropertyList props;
     setRectCoordProps(textCoord, &props);
     double textRotation = thisTransform.getRotation();
@@ -1119,72 +1021,67 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
       }
       props.insert("librevenge:table-columns", columnWidths);
 
-      m_painter->startTableObject(props);
-
-      const std::map<unsigned, std::vector<unsigned> >::const_iterator it = m_tableCellTextEndsByTextId.find(get(info.m_textId));
-      const std::vector<unsigned> &tableCellTextEnds = (it != m_tableCellTextEndsByTextId.end()) ? it->second : std::vector<unsigned>();
-
-      TableLayout tableLayout(boost::extents[get(info.m_tableInfo).m_numRows][get(info.m_tableInfo).m_numColumns]);
-      createTableLayout(get(info.m_tableInfo).m_cells, tableLayout);
+      painter->startTableObject(props);
 
-      ParagraphToCellMap_t paraToCellMap;
-      ParagraphTexts_t paraTexts;
-      mapTableTextToCells(text, tableCellTextEnds, getCalculatedEncoding(), paraToCellMap, paraTexts);
+      const TableInfo &tableInfo = get(info.m_tableInfo);
+      const TableText *const tableText = getIfExists_const(m_tableTextsByTextId, get(info.m_textId));
+      assert(tableInfo.m_layout.size() == std::size_t(tableInfo.m_numRows) * tableInfo.m_numColumns);
+      const TableLayoutCell *layoutCell = tableInfo.m_layout.data();
 
-      for (unsigned row = 0; row != tableLayout.shape()[0]; ++row)
+      for (unsigned row = 0; row != tableInfo.m_numRows; ++row)
       {
         librevenge::RVNGPropertyList rowProps;
-        if (row < (get(info.m_tableInfo).m_rowHeightsInEmu.size()))
-          rowProps.insert("librevenge:row-height", double(get(info.m_tableInfo).m_rowHeightsInEmu[row]) / EMUS_IN_INCH);
-        m_painter->openTableRow(rowProps);
+        if (row < (tableInfo.m_rowHeightsInEmu.size()))
+          rowProps.insert("librevenge:row-height", double(tableInfo.m_rowHeightsInEmu[row]) / EMUS_IN_INCH);
+        painter->openTableRow(rowProps);
 
-        for (unsigned col = 0; col != tableLayout.shape()[1]; ++col)
+        for (unsigned col = 0; col != tableInfo.m_numColumns; ++col, ++layoutCell)
         {
           librevenge::RVNGPropertyList cellProps;
           cellProps.insert("librevenge:column", int(col));
           cellProps.insert("librevenge:row", int(row));
 
-          if (isCovered(tableLayout[row][col]))
+          if (isCovered(*layoutCell))
           {
-            m_painter->insertCoveredTableCell(cellProps);
+            painter->insertCoveredTableCell(cellProps);
           }
           else
           {
-            if (tableLayout[row][col].m_colSpan > 1)
-              cellProps.insert("table:number-columns-spanned", int(tableLayout[row][col].m_colSpan));
-            if (tableLayout[row][col].m_rowSpan > 1)
-              cellProps.insert("table:number-rows-spanned", int(tableLayout[row][col].m_rowSpan));
+            if (layoutCell->m_colSpan > 1)
+              cellProps.insert("table:number-columns-spanned", int(layoutCell->m_colSpan));
+            if (layoutCell->m_rowSpan > 1)
+              cellProps.insert("table:number-rows-spanned", int(layoutCell->m_rowSpan));
 
-            m_painter->openTableCell(cellProps);
+            painter->openTableCell(cellProps);
 
-            if (tableLayout[row][col].m_cell < paraToCellMap.size())
+            if (tableText && layoutCell->m_cell < tableText->m_cellParagraphs.size())
             {
-              const std::pair<unsigned, unsigned> &cellParas = paraToCellMap[tableLayout[row][col].m_cell];
+              const std::pair<unsigned, unsigned> &cellParas = tableText->m_cellParagraphs[layoutCell->m_cell];
               for (unsigned para = cellParas.first; para <= cellParas.second; ++para)
               {
-                librevenge::RVNGPropertyList paraProps = getParaStyleProps(text[para].style, text[para].style.m_defaultCharStyleIndex);
-                m_painter->openParagraph(paraProps);
+                const ParagraphStyle &paraStyle = m_paraStyles[text[para].m_styleId];
+                painter->openParagraph(getParaStyleProps(text[para].m_styleId));
 
-                for (size_t i_spans = 0; i_spans < paraTexts[para].size(); ++i_spans)
+                const unsigned firstSpan = text[para].m_firstSpan;
+                for (unsigned i = firstSpan; i != firstSpan + tableText->m_paragraphSpanCounts[para]; ++i)
                 {
-                  librevenge::RVNGPropertyList charProps = getCharStyleProps(text[para].spans[i_spans].style, text[para].style.m_defaultCharStyleIndex);
-                  m_painter->openSpan(charProps);
-                  separateSpacesAndInsertText(m_painter, paraTexts[para][i_spans]);
-                  m_painter->closeSpan();
+                  painter->openSpan(getCharStyleProps(m_textSpans[i].m_styleId, paraStyle.m_defaultCharStyleIndex));
+                  separateSpacesAndInsertText(painter, m_decodedTextSpans[i]);
+                  painter->closeSpan();
                 }
 
-                m_painter->closeParagraph();
+                painter->closeParagraph();
               }
             }
 
-            m_painter->closeTableCell();
+            painter->closeTableCell();
           }
         }
 
-        m_painter->closeTableRow();
+        painter->closeTableRow();
       }
 
-      m_painter->endTableObject();
+      painter->endTableObject();
     }
     else // a text object
     {
@@ -1221,29 +1118,26 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
         if (ngap > 0)
           props.insert("fo:column-gap", (double)ngap / EMUS_IN_INCH);
       }
-      m_painter->startTextObject(props);
-      for (const auto &line : text)
+      painter->startTextObject(props);
+      for (unsigned para = 0; para != maybeText->m_paragraphCount; ++para)
       {
-        librevenge::RVNGPropertyList paraProps = getParaStyleProps(line.style, line.style.m_defaultCharStyleIndex);
-        m_painter->openParagraph(paraProps);
-        for (size_t i_spans = 0; i_spans < line.spans.size(); ++i_spans)
+        const TextParagraphRecord &line = text[para];
+        const ParagraphStyle &paraStyle = m_paraStyles[line.m_styleId];
+        painter->openParagraph(getParaStyleProps(line.m_styleId));
+        for (unsigned i = line.m_firstSpan; i != line.m_firstSpan + line.m_spanCount; ++i)
         {
-          librevenge::RVNGString textString;
-          appendCharacters(textString, line.spans[i_spans].chars,
-                           getCalculatedEncoding());
-          librevenge::RVNGPropertyList charProps = getCharStyleProps(line.spans[i_spans].style, line.style.m_defaultCharStyleIndex);
-          m_painter->openSpan(charProps);
-          separateSpacesAndInsertText(m_painter, textString);
-          m_painter->closeSpan();
+          painter->openSpan(getCharStyleProps(m_textSpans[i].m_styleId, paraStyle.m_defaultCharStyleIndex));
+          separateSpacesAndInsertText(painter, m_decodedTextSpans[i]);
+          painter->closeSpan();
         }
-        m_painter->closeParagraph();
+        painter->closeParagraph();
       }
-      m_painter->endTextObject();
+      painter->endTextObject();
     }
   }
   if (makeLayer)
   {
-    m_painter->endLayer();
+    painter->endLayer();
   }
   return &no_op;
 }
@@ -1269,7 +1163,7 @@ const char *MSPUBCollector::getCalculatedEncoding() const
   int matchesFound = -1;
   const char *name = nullptr;
   const char *windowsName = nullptr;
-  if (m_allText.empty())
+  if (m_textBuffer.empty())
   {
     goto csd_fail;
   }
@@ -1278,7 +1172,7 @@ const char *MSPUBCollector::getCalculatedEncoding() const
     goto csd_fail;
   }
   // don't worry, the below call doesn't require a null-terminated string.
-  ucsdet_setText(ucd, (const char *)m_allText.data(), m_allText.size(), &status);
+  ucsdet_setText(ucd, (const char *)m_textBuffer.data(), m_textBuffer.size(), &status);
   if (U_FAILURE(status))
   {
     goto csd_fail;
@@ -1316,11 +1210,11 @@ void MSPUBCollector::setShapeLineBackColor(unsigned shapeSeqNum,
   m_shapeInfosBySeqNum[shapeSeqNum].m_lineBackColor = backColor;
 }
 
-void MSPUBCollector::writeImage(double x, double y,
-                                double height, double width, ImgType type, const librevenge::RVNGBinaryData &blob,
+void MSPUBCollector::writeImage(librevenge::RVNGDrawingInterface *painter, double x, double y,
+                                double height, double width, const librevenge::RVNGPropertyList &imgProps,
                                 boost::optional<Color> oneBitColor) const
 {
-  librevenge::RVNGPropertyList props;
+  librevenge::RVNGPropertyList props(imgProps);
   if (bool(oneBitColor))
   {
     Color obc = oneBitColor.get();
@@ -1333,12 +1227,10 @@ void MSPUBCollector::writeImage(double x, double y,
   props.insert("svg:y", y);
   props.insert("svg:width", width);
   props.insert("svg:height", height);
-  props.insert("librevenge:mime-type", mimeByImgType(type));
-  props.insert("office:binary-data", blob);
-  m_painter->drawGraphicObject(props);
+  painter->drawGraphicObject(props);
 }
 
-double MSPUBCollector::getSpecialValue(const ShapeInfo &info, const CustomShape &shape, int arg, const std::vector<int> &adjustValues) const
+double MSPUBCollector::getSpecialValue(const ShapeInfo &info, const CustomShape &shape, int arg, const std::vector<int> &adjustValues, std::vector<bool> &seen) const
 {
   if (PROP_ADJUST_VAL_FIRST <= arg && PROP_ADJUST_VAL_LAST >= arg)
   {
@@ -1360,7 +1252,7 @@ double MSPUBCollector::getSpecialValue(const ShapeInfo &info, const CustomShape
   }
   if (arg & OTHER_CALC_VAL)
   {
-    return getCalculationValue(info, arg & 0xff, true, adjustValues);
+    return getCalculationValue(info, arg & 0xff, adjustValues, seen);
   }
   switch (arg)
   {
@@ -1378,40 +1270,47 @@ double MSPUBCollector::getSpecialValue(const ShapeInfo &info, const CustomShape
   return 0;
 }
 
-double MSPUBCollector::getCalculationValue(const ShapeInfo &info, unsigned index, bool recursiveEntry, const std::vector<int> &adjustValues) const
+double MSPUBCollector::getCalculationValue(const ShapeInfo &info, unsigned index, const std::vector<int> &adjustValues) const
 {
   std::shared_ptr<const CustomShape> p_shape = info.getCustomShape();
   if (! p_shape)
   {
     return 0;
   }
-  const CustomShape &shape = *p_shape;
-  if (index >= shape.m_numCalculations)
+  // kept per evaluation rather than in the collector, as pages may be painted concurrently
+  std::vector<bool> seen(p_shape->m_numCalculations);
+  return getCalculationValue(info, index, adjustValues, seen);
+}
+
+double MSPUBCollector::getCalculationValue(const ShapeInfo &info, unsigned index, const std::vector<int> &adjustValues, std::vector<bool> &seen) const
+{
+  std::shared_ptr<const CustomShape> p_shape = info.getCustomShape();
+  if (! p_shape)
   {
     return 0;
   }
-  if (! recursiveEntry)
+  const CustomShape &shape = *p_shape;
+  if (index >= shape.m_numCalculations)
   {
-    m_calculationValuesSeen.clear();
-    m_calculationValuesSeen.resize(shape.m_numCalculations);
+    return 0;
   }
-  if (m_calculationValuesSeen[index])
+  if (seen[index])
   {
     //recursion detected. The simplest way to avoid infinite recursion, at the "cost"
     // of making custom shape parsing not Turing-complete ;), is to ban recursion entirely.
     return 0;
   }
-  m_calculationValuesSeen[index] = true;
+  seen[index] = true;
 
   const Calculation &c = shape.mp_calculations[index];
   bool oneSpecial = (c.m_flags & 0x2000) != 0;
   bool twoSpecial = (c.m_flags & 0x4000) != 0;
   bool threeSpecial = (c.m_flags & 0x8000) != 0;
 
-  double valOne = oneSpecial ? getSpecialValue(info, shape, c.m_argOne, adjustValues) : c.m_argOne;
-  double valTwo = twoSpecial ? getSpecialValue(info, shape, c.m_argTwo, adjustValues) : c.m_argTwo;
-  double valThree = threeSpecial ? getSpecialValue(info, shape, c.m_argThree, adjustValues) : c.m_argThree;
-  m_calculationValuesSeen[index] = false;
+  double valOne = oneSpecial ? getSpecialValue(info, shape, c.m_argOne, adjustValues, seen) : c.m_argOne;
+  double valTwo = twoSpecial ? getSpecialValue(info, shape, c.m_argTwo, adjustValues, seen) : c.m_argTwo;
+  double valThree = threeSpecial ? getSpecialValue(info, shape, c.m_argThree, adjustValues, seen) : c.m_argThree;
+  seen[index] = false;
   switch (c.m_flags & 0xFF)
   {
   case 0:
@@ -1493,6 +1392,22 @@ void MSPUBCollector::addDefaultParagraphStyle(const ParagraphStyle &st)
   m_defaultParaStyles.push_back(st);
 }
 
+unsigned MSPUBCollector::addCharacterStyle(const CharacterStyle &style)
+{
+  const auto inserted = m_charStyleIds.insert(std::make_pair(style, unsigned(m_charStyles.size())));
+  if (inserted.second)
+    m_charStyles.push_back(style);
+  return inserted.first->second;
+}
+
+unsigned MSPUBCollector::addParagraphStyle(const ParagraphStyle &style)
+{
+  const auto inserted = m_paraStyleIds.insert(std::make_pair(style, unsigned(m_paraStyles.size())));
+  if (inserted.second)
+    m_paraStyles.push_back(style);
+  return inserted.first->second;
+}
+
 bool MSPUBCollector::addPage(unsigned seqNum)
 {
   if (!(m_widthSet && m_heightSet))
@@ -1534,9 +1449,34 @@ void MSPUBCollector::setShapeCoordinatesInEmu(unsigned seqNum, int xs, int ys, i
   m_shapeInfosBySeqNum[seqNum].m_coordinates = Coordinate(xs, ys, xe, ye);
 }
 
-void MSPUBCollector::addFont(std::vector<unsigned char> name)
+void MSPUBCollector::addFont(const std::vector<unsigned char> &name)
+{
+  // font names only come from Quill FONT chunks, which are always UTF-16
+  librevenge::RVNGString str;
+  appendCharacters(str, name, "UTF-16LE");
+  m_fonts.push_back(str);
+}
+
+const librevenge::RVNGPropertyList &MSPUBCollector::getParaStyleProps(const unsigned styleId) const
 {
-  m_fonts.push_back(name);
+  std::lock_guard<std::mutex> lock(m_stylePropsCacheMutex);
+  auto it = m_paraStylePropsCache.find(styleId);
+  if (it == m_paraStylePropsCache.end())
+  {
+    const ParagraphStyle &style = m_paraStyles[styleId];
+    it = m_paraStylePropsCache.insert(std::make_pair(styleId, getParaStyleProps(style, style.m_defaultCharStyleIndex))).first;
+  }
+  return it->second;
+}
+
+const librevenge::RVNGPropertyList &MSPUBCollector::getCharStyleProps(const unsigned styleId, const boost::optional<unsigned> defaultCharStyleIndex) const
+{
+  const std::pair<unsigned, unsigned> key(styleId, defaultCharStyleIndex.get_value_or(0));
+  std::lock_guard<std::mutex> lock(m_stylePropsCacheMutex);
+  auto it = m_charStylePropsCache.find(key);
+  if (it == m_charStylePropsCache.end())
+    it = m_charStylePropsCache.insert(std::make_pair(key, getCharStyleProps(m_charStyles[styleId], key.second))).first;
+  return it->second;
 }
 
 librevenge::RVNGPropertyList MSPUBCollector::getParaStyleProps(const ParagraphStyle &style, boost::optional<unsigned> defaultParaStyleIndex) const
@@ -1683,25 +1623,16 @@ librevenge::RVNGPropertyList MSPUBCollector::getCharStyleProps(const CharacterSt
   if (bool(style.fontIndex) &&
       style.fontIndex.get() < m_fonts.size())
   {
-    librevenge::RVNGString str;
-    appendCharacters(str, m_fonts[style.fontIndex.get()],
-                     getCalculatedEncoding());
-    ret.insert("style:font-name", str);
+    ret.insert("style:font-name", m_fonts[style.fontIndex.get()]);
   }
   else if (bool(defaultCharStyle.fontIndex) &&
            defaultCharStyle.fontIndex.get() < m_fonts.size())
   {
-    librevenge::RVNGString str;
-    appendCharacters(str, m_fonts[defaultCharStyle.fontIndex.get()],
-                     getCalculatedEncoding());
-    ret.insert("style:font-name", str);
+    ret.insert("style:font-name", m_fonts[defaultCharStyle.fontIndex.get()]);
   }
   else if (!m_fonts.empty())
   {
-    librevenge::RVNGString str;
-    appendCharacters(str, m_fonts[0],
-                     getCalculatedEncoding());
-    ret.insert("style:font-name", str);
+    ret.insert("style:font-name", m_fonts[0]);
   }
   switch (style.superSubType)
   {
@@ -1742,7 +1673,6 @@ void MSPUBCollector::assignShapesToPages()
   for (auto &topLevelShape : m_topLevelShapes)
   {
     unsigned *ptr_pageSeqNum = getIfExists(m_pageSeqNumsByShapeSeqNum, topLevelShape->getSeqNum());
-    topLevelShape->setup(std::bind(&MSPUBCollector::setupShapeStructures, this, _1));
     if (ptr_pageSeqNum)
     {
       PageInfo *ptr_page = getIfExists(m_pagesBySeqNum, *ptr_pageSeqNum);
@@ -1752,6 +1682,23 @@ void MSPUBCollector::assignShapesToPages()
       }
     }
   }
+
+  // Only the shapes of the pages that are painted, and of their master
+  // pages, need setting up.
+  std::set<unsigned> paintedPages;
+  for (unsigned pageSeqNum : getPagesToWrite())
+  {
+    paintedPages.insert(pageSeqNum);
+    const boost::optional<unsigned> masterSeqNum = getMasterPageSeqNum(pageSeqNum);
+    if (bool(masterSeqNum))
+      paintedPages.insert(masterSeqNum.get());
+  }
+  for (auto &topLevelShape : m_topLevelShapes)
+  {
+    const unsigned *ptr_pageSeqNum = getIfExists_const(m_pageSeqNumsByShapeSeqNum, topLevelShape->getSeqNum());
+    if (!ptr_pageSeqNum || paintedPages.find(*ptr_pageSeqNum) != paintedPages.end())
+      topLevelShape->setup(std::bind(&MSPUBCollector::setupShapeStructures, this, _1));
+  }
 }
 
 boost::optional<unsigned> MSPUBCollector::getMasterPageSeqNum(unsigned pageSeqNum) const
@@ -1765,7 +1712,7 @@ boost::optional<unsigned> MSPUBCollector::getMasterPageSeqNum(unsigned pageSeqNu
   return toReturn;
 }
 
-void MSPUBCollector::writePage(unsigned pageSeqNum) const
+void MSPUBCollector::writePage(librevenge::RVNGDrawingInterface *const painter, unsigned pageSeqNum) const
 {
   const PageInfo &pageInfo = m_pagesBySeqNum.find(pageSeqNum)->second;
   librevenge::RVNGPropertyList pageProps;
@@ -1780,31 +1727,31 @@ void MSPUBCollector::writePage(unsigned pageSeqNum) const
   const auto &shapeGroupsOrdered = pageInfo.m_shapeGroupsOrdered;
   if (!shapeGroupsOrdered.empty())
   {
-    m_painter->startPage(pageProps);
+    painter->startPage(pageProps);
     boost::optional<unsigned> masterSeqNum = getMasterPageSeqNum(pageSeqNum);
     auto hasMaster = bool(masterSeqNum);
     if (hasMaster)
     {
-      writePageBackground(masterSeqNum.get());
+      writePageBackground(painter, masterSeqNum.get());
     }
-    writePageBackground(pageSeqNum);
+    writePageBackground(painter, pageSeqNum);
     if (hasMaster)
     {
-      writePageShapes(masterSeqNum.get());
+      writePageShapes(painter, masterSeqNum.get());
     }
-    writePageShapes(pageSeqNum);
-    m_painter->endPage();
+    writePageShapes(painter, pageSeqNum);
+    painter->endPage();
   }
 }
 
-void MSPUBCollector::writePageShapes(unsigned pageSeqNum) const
+void MSPUBCollector::writePageShapes(librevenge::RVNGDrawingInterface *const painter, unsigned pageSeqNum) const
 {
   const PageInfo &pageInfo = m_pagesBySeqNum.find(pageSeqNum)->second;
   for (const auto &shapeGroup : pageInfo.m_shapeGroupsOrdered)
-    shapeGroup->visit(std::bind(&MSPUBCollector::paintShape, this, _1, _2, _3, _4, _5));
+    shapeGroup->visit(std::bind(&MSPUBCollector::paintShape, this, painter, _1, _2, _3, _4, _5));
 }
 
-void MSPUBCollector::writePageBackground(unsigned pageSeqNum) const
+void MSPUBCollector::writePageBackground(librevenge::RVNGDrawingInterface *const painter, unsigned pageSeqNum) const
 {
   const unsigned *ptr_fillSeqNum = getIfExists_const(m_bgShapeSeqNumsByPageSeqNum, pageSeqNum);
   if (ptr_fillSeqNum)
@@ -1823,32 +1770,50 @@ void MSPUBCollector::writePageBackground(unsigned pageSeqNum) const
       bg.m_coordinates = wholePage;
       bg.m_pageSeqNum = pageSeqNum;
       bg.m_fill = ptr_fill;
-      paintShape(bg, Coordinate(), VectorTransformation2D(), false, VectorTransformation2D());
+      paintShape(painter, bg, Coordinate(), VectorTransformation2D(), false, VectorTransformation2D());
     }
   }
 }
 
-bool MSPUBCollector::pageIsMaster(unsigned pageSeqNum) const
+void MSPUBCollector::writePages(librevenge::RVNGDrawingInterface *const painter, const std::vector<unsigned> &pageSeqNums, const std::vector<std::vector<unsigned> > &imagesByPage) const
 {
-  return m_masterPages.find(pageSeqNum) != m_masterPages.end();
-}
-
-bool MSPUBCollector::go()
-{
-  addBlackToPaletteIfNecessary();
-  assignShapesToPages();
-  m_painter->startDocument(librevenge::RVNGPropertyList());
-  m_painter->setDocumentMetaData(m_metaData);
+  if (m_threadCount <= 1 || pageSeqNums.size() < 2)
+  {
+    for (std::size_t i = 0; i < pageSeqNums.size(); ++i)
+    {
+      if (m_threadCount > 1)
+        m_images.decodeImages(imagesByPage[i], m_threadCount);
+      writePage(painter, pageSeqNums[i]);
+    }
+    return;
+  }
 
-  for (std::list<EmbeddedFontInfo>::const_iterator i = m_embeddedFonts.begin(); i != m_embeddedFonts.end(); ++i)
+  // Paint the pages into recordings on the worker threads, a few pages
+  // per thread at a time to bound the memory held by the recordings, and
+  // replay them into the real painter in page order.
+  const std::size_t batchSize = 2 * std::size_t(m_threadCount);
+  for (std::size_t first = 0; first < pageSeqNums.size(); first += batchSize)
   {
-    librevenge::RVNGPropertyList props;
-    props.insert("librevenge:name", i->m_name);
-    props.insert("librevenge:mime-type", "application/vnd.ms-fontobject");
-    props.insert("office:binary-data",i->m_blob);
-    m_painter->defineEmbeddedFont(props);
+    const std::size_t count = std::min(batchSize, pageSeqNums.size() - first);
+    std::vector<unsigned> batchImages;
+    for (std::size_t i = first; i < first + count; ++i)
+      batchImages.insert(batchImages.end(), imagesByPage[i].begin(), imagesByPage[i].end());
+    m_images.decodeImages(batchImages, m_threadCount);
+
+    std::vector<std::unique_ptr<RecordingPainter> > recordings(count);
+    runTasks(count, m_threadCount, [&](const std::size_t i)
+    {
+      recordings[i].reset(new RecordingPainter());
+      writePage(recordings[i].get(), pageSeqNums[first + i]);
+    });
+    for (const auto &recording : recordings)
+      recording->replay(painter);
   }
+}
 
+std::vector<unsigned> MSPUBCollector::getPagesToWrite() const
+{
+  std::vector<unsigned> pages;
   if (m_pageSeqNumsOrdered.empty())
   {
     for (std::map<unsigned, PageInfo>::const_iterator i = m_pagesBySeqNum.begin();
@@ -1856,7 +1821,7 @@ bool MSPUBCollector::go()
     {
       if (!pageIsMaster(i->first))
       {
-        writePage(i->first);
+        pages.push_back(i->first);
       }
     }
   }
@@ -1868,37 +1833,171 @@ bool MSPUBCollector::go()
         m_pagesBySeqNum.find(i);
       if (iter != m_pagesBySeqNum.end() && !pageIsMaster(iter->first))
       {
-        writePage(iter->first);
+        pages.push_back(iter->first);
       }
     }
   }
-  m_painter->endDocument();
+  if (m_isPageSelected)
+  {
+    // pages without shapes are not painted, so they are not counted
+    std::vector<unsigned> selectedPages;
+    unsigned index = 0;
+    for (unsigned pageSeqNum : pages)
+    {
+      if (m_pagesBySeqNum.find(pageSeqNum)->second.m_shapeGroupsOrdered.empty())
+        continue;
+      if (m_isPageSelected(index++))
+        selectedPages.push_back(pageSeqNum);
+    }
+    pages.swap(selectedPages);
+  }
+  return pages;
+}
+
+void MSPUBCollector::getPageImages(const std::vector<unsigned> &pageSeqNums, std::vector<std::vector<unsigned> > &imagesByPage) const
+{
+  // Walks the pages the same way writePage() does, listing an image once
+  // for every fill that draws it.
+  imagesByPage.clear();
+  imagesByPage.resize(pageSeqNums.size());
+  std::vector<unsigned> *pageImages = nullptr;
+  auto countFill = [this, &pageImages](const std::shared_ptr<const Fill> &fill)
+  {
+    const unsigned index = fill ? fill->getImgIndex() : 0;
+    if (m_images.hasImage(index))
+      pageImages->push_back(index);
+  };
+  auto countShape = [&countFill](const ShapeInfo &info, const Coordinate &, const VectorTransformation2D &, bool isGroup, const VectorTransformation2D &) -> std::function<void(void)>
+  {
+    if (!isGroup)
+      countFill(info.m_fill);
+    return []() {};
+  };
+  auto countPage = [this, &countFill, &countShape](unsigned pageSeqNum)
+  {
+    const unsigned *ptr_fillSeqNum = getIfExists_const(m_bgShapeSeqNumsByPageSeqNum, pageSeqNum);
+    if (ptr_fillSeqNum)
+    {
+      const ShapeInfo *ptr_info = getIfExists_const(m_shapeInfosBySeqNum, *ptr_fillSeqNum);
+      if (ptr_info)
+        countFill(ptr_info->m_fill);
+    }
+    for (const auto &shapeGroup : m_pagesBySeqNum.find(pageSeqNum)->second.m_shapeGroupsOrdered)
+      shapeGroup->visit(countShape);
+  };
+  for (std::size_t i = 0; i < pageSeqNums.size(); ++i)
+  {
+    const unsigned pageSeqNum = pageSeqNums[i];
+    if (m_pagesBySeqNum.find(pageSeqNum)->second.m_shapeGroupsOrdered.empty())
+      continue;
+    pageImages = &imagesByPage[i];
+    boost::optional<unsigned> masterSeqNum = getMasterPageSeqNum(pageSeqNum);
+    if (bool(masterSeqNum))
+      countPage(masterSeqNum.get());
+    countPage(pageSeqNum);
+  }
+}
+
+bool MSPUBCollector::pageIsMaster(unsigned pageSeqNum) const
+{
+  return m_masterPages.find(pageSeqNum) != m_masterPages.end();
+}
+
+bool MSPUBCollector::go()
+{
+  addBlackToPaletteIfNecessary();
+  assignShapesToPages();
+  decodeTextStrings();
+  setupTableTexts();
+  encodeBorderImages();
+  if (!m_painter)
+  {
+    // The document may be painted after the input it was parsed from is
+    // gone, so the delayed images must not be read from it then.
+    m_images.copyStream();
+    return true;
+  }
+
+  const std::vector<unsigned> pagesToWrite = getPagesToWrite();
+  std::vector<std::vector<unsigned> > imagesByPage;
+  getPageImages(pagesToWrite, imagesByPage);
+  // Painting only once, so every image can be released by the fill that
+  // draws it for the last time.
+  m_images.clearUses();
+  for (const auto &pageImages : imagesByPage)
+  {
+    for (unsigned index : pageImages)
+      m_images.addUse(index);
+  }
+  writeDocument(m_painter, pagesToWrite, imagesByPage);
+  m_charStylePropsCache.clear();
+  m_paraStylePropsCache.clear();
   return true;
 }
 
+bool MSPUBCollector::render(librevenge::RVNGDrawingInterface *const painter) const
+{
+  // The images have no announced uses here, so they are kept once read.
+  const std::vector<unsigned> pagesToWrite = getPagesToWrite();
+  std::vector<std::vector<unsigned> > imagesByPage;
+  getPageImages(pagesToWrite, imagesByPage);
+  writeDocument(painter, pagesToWrite, imagesByPage);
+  return true;
+}
 
-bool MSPUBCollector::addTextString(const std::vector<TextParagraph> &str, unsigned id)
+void MSPUBCollector::writeDocument(librevenge::RVNGDrawingInterface *const painter, const std::vector<unsigned> &pageSeqNums, const std::vector<std::vector<unsigned> > &imagesByPage) const
 {
-  MSPUB_DEBUG_MSG(("addTextString, id: 0x%x\n", id));
-  m_textStringsById[id] = str;
-  if (m_encodingHeuristic)
+  painter->startDocument(librevenge::RVNGPropertyList());
+  painter->setDocumentMetaData(m_metaData);
+
+  for (std::list<EmbeddedFontInfo>::const_iterator i = m_embeddedFonts.begin(); i != m_embeddedFonts.end(); ++i)
   {
-    ponderStringEncoding(str);
+    librevenge::RVNGPropertyList props;
+    props.insert("librevenge:name", i->m_name);
+    props.insert("librevenge:mime-type", "application/vnd.ms-fontobject");
+    props.insert("office:binary-data",i->m_blob);
+    painter->defineEmbeddedFont(props);
   }
-  return true; //FIXME: Warn if the string already existed in the map.
+
+  writePages(painter, pageSeqNums, imagesByPage);
+  painter->endDocument();
 }
 
-void MSPUBCollector::ponderStringEncoding(
-  const std::vector<TextParagraph> &str)
+unsigned MSPUBCollector::getPageCount() const
 {
-  for (const auto &i : str)
+  unsigned count = 0;
+  for (unsigned pageSeqNum : getPagesToWrite())
   {
-    for (size_t j = 0; j < i.spans.size(); ++j)
+    if (!m_pagesBySeqNum.find(pageSeqNum)->second.m_shapeGroupsOrdered.empty())
+      ++count;
+  }
+  return count;
+}
+
+double MSPUBCollector::getWidth() const
+{
+  return m_widthSet ? m_width : 0;
+}
+
+double MSPUBCollector::getHeight() const
+{
+  return m_heightSet ? m_height : 0;
+}
+
+bool MSPUBCollector::addTextString(const std::vector<TextParagraph> &str, unsigned id)
+{
+  MSPUB_DEBUG_MSG(("addTextString, id: 0x%x\n", id));
+  m_textStringsById[id] = TextStringRecord(unsigned(m_textParagraphs.size()), unsigned(str.size()));
+  for (const auto &para : str)
+  {
+    m_textParagraphs.push_back(TextParagraphRecord(unsigned(m_textSpans.size()), unsigned(para.spans.size()), para.styleId));
+    for (const auto &span : para.spans)
     {
-      const std::vector<unsigned char> &chars = i.spans[j].chars;
-      m_allText.insert(m_allText.end(), chars.begin(), chars.end());
+      m_textSpans.push_back(TextSpanRecord(unsigned(m_textBuffer.size()), unsigned(span.chars.size()), span.styleId));
+      m_textBuffer.insert(m_textBuffer.end(), span.chars.data(), span.chars.data() + span.chars.size());
     }
   }
+  return true; //FIXME: Warn if the string already existed in the map.
 }
 
 void MSPUBCollector::setWidthInEmu(unsigned long widthInEmu)
@@ -1917,14 +2016,24 @@ void MSPUBCollector::setHeightInEmu(unsigned long heightInEmu)
 
 bool MSPUBCollector::addImage(unsigned index, ImgType type, librevenge::RVNGBinaryData img)
 {
-  while (m_images.size() < index)
+  if (index > 0)
   {
-    m_images.push_back(std::pair<ImgType, librevenge::RVNGBinaryData>(UNKNOWN, librevenge::RVNGBinaryData()));
+    MSPUB_DEBUG_MSG(("Image at index %u and of type 0x%x added.\n", index, type));
+    m_images.addImage(index, type, img);
   }
+  else
+  {
+    MSPUB_DEBUG_MSG(("0 is not a valid index for image, ignoring.\n"));
+  }
+  return index > 0;
+}
+
+bool MSPUBCollector::addDelayedImage(unsigned index, ImgType type, unsigned long offset, unsigned long length, unsigned long decodedSize)
+{
   if (index > 0)
   {
-    MSPUB_DEBUG_MSG(("Image at index %u and of type 0x%x added.\n", index, type));
-    m_images[index - 1] = std::pair<ImgType, librevenge::RVNGBinaryData>(type, img);
+    MSPUB_DEBUG_MSG(("Image at index %u and of type 0x%x found at offset 0x%lx.\n", index, type, offset));
+    m_images.addDelayedImage(index, type, offset, length, decodedSize);
   }
   else
   {
@@ -1933,6 +2042,21 @@ bool MSPUBCollector::addImage(unsigned index, ImgType type, librevenge::RVNGBina
   return index > 0;
 }
 
+void MSPUBCollector::setThreadCount(const unsigned count)
+{
+  m_threadCount = count;
+}
+
+void MSPUBCollector::setPageSelection(std::function<bool(unsigned index)> isSelected)
+{
+  m_isPageSelected = isSelected;
+}
+
+void MSPUBCollector::setImageStream(std::unique_ptr<librevenge::RVNGInputStream> stream)
+{
+  m_images.setStream(std::move(stream));
+}
+
 librevenge::RVNGBinaryData *MSPUBCollector::addBorderImage(ImgType type,
                                                            unsigned borderArtIndex)
 {
@@ -1952,21 +2076,9 @@ void MSPUBCollector::setBorderImageOffset(unsigned index, unsigned offset)
   }
   BorderArtInfo &bai = m_borderImages[index];
   bai.m_offsets.push_back(offset);
-  bool added = false;
-  for (auto i = bai.m_offsetsOrdered.begin();
-       i != bai.m_offsetsOrdered.end(); ++i)
-  {
-    if (*i >= offset)
-    {
-      bai.m_offsetsOrdered.insert(i, offset);
-      added = true;
-      break;
-    }
-  }
-  if (!added)
-  {
-    bai.m_offsetsOrdered.push_back(offset);
-  }
+  bai.m_offsetsOrdered.insert(
+    std::lower_bound(bai.m_offsetsOrdered.begin(), bai.m_offsetsOrdered.end(), offset),
+    offset);
 }
 
 void MSPUBCollector::setShapePage(unsigned seqNum, unsigned pageSeqNum)
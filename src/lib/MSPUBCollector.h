@@ -10,8 +10,11 @@
 #ifndef INCLUDED_MSPUBCOLLECTOR_H
 #define INCLUDED_MSPUBCOLLECTOR_H
 
+#include <functional>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <utility>
 #include <vector>
@@ -21,6 +24,7 @@
 #include "BorderArtInfo.h"
 #include "ColorReference.h"
 #include "EmbeddedFontInfo.h"
+#include "ImageStore.h"
 #include "MSPUBTypes.h"
 #include "PolygonUtils.h"
 #include "ShapeInfo.h"
@@ -59,8 +63,15 @@ public:
 
   bool addPage(unsigned seqNum);
   bool addTextString(const std::vector<TextParagraph> &str, unsigned id);
+  /// Takes over the text, text styles, fonts and text colors of a collector that only has those, into one that has none yet.
+  void mergeText(MSPUBCollector &other);
   void addTextShape(unsigned stringId, unsigned seqNum);
   bool addImage(unsigned index, ImgType type, librevenge::RVNGBinaryData img);
+  bool addDelayedImage(unsigned index, ImgType type, unsigned long offset, unsigned long length, unsigned long decodedSize);
+  void setThreadCount(unsigned count);
+  /// Restricts the painted pages to those whose zero-based index among the painted pages is accepted by isSelected.
+  void setPageSelection(std::function<bool(unsigned index)> isSelected);
+  void setImageStream(std::unique_ptr<librevenge::RVNGInputStream> stream);
   void setBorderImageOffset(unsigned index, unsigned offset);
   librevenge::RVNGBinaryData *addBorderImage(ImgType type, unsigned borderArtIndex);
   void setShapePage(unsigned seqNum, unsigned pageSeqNum);
@@ -112,10 +123,14 @@ public:
   void setShapeEndArrow(unsigned seqNum, const Arrow &arrow);
 
   void addTextColor(ColorReference c);
-  void addFont(std::vector<unsigned char> name);
+  void addFont(const std::vector<unsigned char> &name);
 
   void addDefaultCharacterStyle(const CharacterStyle &style);
   void addDefaultParagraphStyle(const ParagraphStyle &style);
+  // Styles are shared between all text of the document; these return
+  // the id of an equal style if there already is one.
+  unsigned addCharacterStyle(const CharacterStyle &style);
+  unsigned addParagraphStyle(const ParagraphStyle &style);
   void addPaletteColor(Color);
   bool setCurrentGroupSeqNum(unsigned seqNum);
 
@@ -124,7 +139,21 @@ public:
   void setTableCellTextEnds(unsigned textId, const std::vector<unsigned> &ends);
   void setTextStringOffset(unsigned textId, unsigned offset);
 
+  /** Finishes the document and paints it into the collector's painter.
+    *
+    * Without a painter, the document is only finished, and can then be
+    * painted any number of times with render(). It then no longer reads
+    * from the streams it was given.
+    */
   bool go();
+  /// Paints the finished document; may be called concurrently with different painters.
+  bool render(librevenge::RVNGDrawingInterface *painter) const;
+  /// Returns the number of pages render() paints.
+  unsigned getPageCount() const;
+  /// Returns the page width in inches, or 0 if it is not known.
+  double getWidth() const;
+  /// Returns the page height in inches, or 0 if it is not known.
+  double getHeight() const;
 
   bool hasPage(unsigned seqNum) const;
 private:
@@ -135,6 +164,14 @@ private:
     PageInfo() : m_shapeGroupsOrdered() { }
   };
 
+  /// Division of the text of a table into cells, worked out by go()
+  struct TableText
+  {
+    TableText() : m_cellParagraphs(), m_paragraphSpanCounts() { }
+    std::vector<std::pair<unsigned, unsigned> > m_cellParagraphs; // first and last paragraph of each cell
+    std::vector<unsigned> m_paragraphSpanCounts; // number of spans to paint of each paragraph
+  };
+
   MSPUBCollector(const MSPUBCollector &);
   MSPUBCollector &operator=(const MSPUBCollector &);
 
@@ -143,14 +180,22 @@ private:
   double m_width, m_height;
   bool m_widthSet, m_heightSet;
   unsigned short m_numPages;
-  std::map<unsigned, std::vector<TextParagraph> > m_textStringsById;
+  std::vector<unsigned char> m_textBuffer;
+  std::vector<TextSpanRecord> m_textSpans;
+  std::vector<TextParagraphRecord> m_textParagraphs;
+  std::map<unsigned, TextStringRecord> m_textStringsById;
+  std::vector<librevenge::RVNGString> m_decodedTextSpans; // m_textSpans converted to UTF-8 by go()
   std::map<unsigned, PageInfo> m_pagesBySeqNum;
-  std::vector<std::pair<ImgType, librevenge::RVNGBinaryData> > m_images;
+  ImageStore m_images;
   std::vector<BorderArtInfo> m_borderImages;
   std::vector<ColorReference> m_textColors;
-  std::vector<std::vector<unsigned char> > m_fonts;
+  std::vector<librevenge::RVNGString> m_fonts;
   std::vector<CharacterStyle> m_defaultCharStyles;
   std::vector<ParagraphStyle> m_defaultParaStyles;
+  std::vector<CharacterStyle> m_charStyles;
+  std::map<CharacterStyle, unsigned> m_charStyleIds;
+  std::vector<ParagraphStyle> m_paraStyles;
+  std::map<ParagraphStyle, unsigned> m_paraStyleIds;
   std::map<unsigned, ShapeType> m_shapeTypesBySeqNum;
   std::vector<Color> m_paletteColors;
   std::vector<unsigned> m_shapeSeqNumsOrdered;
@@ -166,37 +211,52 @@ private:
   std::set<unsigned> m_shapesWithCoordinatesRotated90;
   std::map<unsigned, unsigned> m_masterPagesByPageSeqNum;
   std::map<unsigned, std::vector<unsigned> > m_tableCellTextEndsByTextId;
+  std::map<unsigned, TableText> m_tableTextsByTextId;
   std::map<unsigned, unsigned> m_stringOffsetsByTextId;
-  mutable std::vector<bool> m_calculationValuesSeen;
   std::vector<unsigned> m_pageSeqNumsOrdered;
   bool m_encodingHeuristic;
-  std::vector<unsigned char> m_allText;
   mutable boost::optional<const char *> m_calculatedEncoding;
+  unsigned m_threadCount;
+  std::function<bool(unsigned index)> m_isPageSelected;
+  // property lists of the styles used by the text painted so far in go();
+  // pages may be painted concurrently, so they are guarded by m_stylePropsCacheMutex
+  mutable std::mutex m_stylePropsCacheMutex;
+  mutable std::map<std::pair<unsigned, unsigned>, librevenge::RVNGPropertyList> m_charStylePropsCache;
+  mutable std::map<unsigned, librevenge::RVNGPropertyList> m_paraStylePropsCache;
   librevenge::RVNGPropertyList m_metaData;
 
   // helper functions
   std::vector<int> getShapeAdjustValues(const ShapeInfo &info) const;
   boost::optional<unsigned> getMasterPageSeqNum(unsigned pageSeqNum) const;
   void setRectCoordProps(Coordinate, librevenge::RVNGPropertyList *) const;
-  boost::optional<std::vector<libmspub::TextParagraph> > getShapeText(const ShapeInfo &info) const;
+  const TextStringRecord *getShapeText(const ShapeInfo &info) const;
+  void decodeTextStrings();
+  void setupTableTexts();
+  void encodeBorderImages();
   void setupShapeStructures(ShapeGroupElement &elt);
   void addBlackToPaletteIfNecessary();
   void assignShapesToPages();
-  void writePage(unsigned pageSeqNum) const;
-  void writePageShapes(unsigned pageSeqNum) const;
-  void writePageBackground(unsigned pageSeqNum) const;
-  void writeImage(double x, double y, double height, double width,
-                  ImgType type, const librevenge::RVNGBinaryData &blob,
+  void writePage(librevenge::RVNGDrawingInterface *painter, unsigned pageSeqNum) const;
+  void writePageShapes(librevenge::RVNGDrawingInterface *painter, unsigned pageSeqNum) const;
+  void writePageBackground(librevenge::RVNGDrawingInterface *painter, unsigned pageSeqNum) const;
+  void writePages(librevenge::RVNGDrawingInterface *painter, const std::vector<unsigned> &pageSeqNums, const std::vector<std::vector<unsigned> > &imagesByPage) const;
+  void writeDocument(librevenge::RVNGDrawingInterface *painter, const std::vector<unsigned> &pageSeqNums, const std::vector<std::vector<unsigned> > &imagesByPage) const;
+  void writeImage(librevenge::RVNGDrawingInterface *painter, double x, double y, double height, double width,
+                  const librevenge::RVNGPropertyList &imgProps,
                   boost::optional<Color> oneBitColor) const;
   bool pageIsMaster(unsigned pageSeqNum) const;
+  std::vector<unsigned> getPagesToWrite() const;
+  void getPageImages(const std::vector<unsigned> &pageSeqNums, std::vector<std::vector<unsigned> > &imagesByPage) const;
 
-  std::function<void(void)> paintShape(const ShapeInfo &info, const Coordinate &relativeTo, const VectorTransformation2D &foldedTransform, bool isGroup, const VectorTransformation2D &thisTransform) const;
-  double getCalculationValue(const ShapeInfo &info, unsigned index, bool recursiveEntry, const std::vector<int> &adjustValues) const;
+  std::function<void(void)> paintShape(librevenge::RVNGDrawingInterface *painter, const ShapeInfo &info, const Coordinate &relativeTo, const VectorTransformation2D &foldedTransform, bool isGroup, const VectorTransformation2D &thisTransform) const;
+  double getCalculationValue(const ShapeInfo &info, unsigned index, const std::vector<int> &adjustValues) const;
+  double getCalculationValue(const ShapeInfo &info, unsigned index, const std::vector<int> &adjustValues, std::vector<bool> &seen) const;
 
   librevenge::RVNGPropertyList getCharStyleProps(const CharacterStyle &, boost::optional<unsigned> defaultCharStyleIndex) const;
   librevenge::RVNGPropertyList getParaStyleProps(const ParagraphStyle &, boost::optional<unsigned> defaultParaStyleIndex) const;
-  double getSpecialValue(const ShapeInfo &info, const CustomShape &shape, int arg, const std::vector<int> &adjustValues) const;
-  void ponderStringEncoding(const std::vector<TextParagraph> &str);
+  const librevenge::RVNGPropertyList &getCharStyleProps(unsigned styleId, boost::optional<unsigned> defaultCharStyleIndex) const;
+  const librevenge::RVNGPropertyList &getParaStyleProps(unsigned styleId) const;
+  double getSpecialValue(const ShapeInfo &info, const CustomShape &shape, int arg, const std::vector<int> &adjustValues, std::vector<bool> &seen) const;
   const char *getCalculatedEncoding() const;
 public:
   static librevenge::RVNGString getColorString(const Color &);
@@ -12,9 +12,11 @@
 #include <memory>
 
 #include "MSPUBCollector.h"
+#include "MSPUBMetaData.h"
 #include "MSPUBParser.h"
 #include "MSPUBParser2k.h"
 #include "MSPUBParser97.h"
+#include "WorkerPool.h"
 #include "libmspub_utils.h"
 
 namespace libmspub
@@ -70,9 +72,57 @@ MSPUBVersion getVersion(librevenge::RVNGInputStream *input)
 
 }
 
+bool parseWith(librevenge::RVNGInputStream *input, MSPUBCollector &collector, const MSPUBParseOptions &options)
+{
+  const unsigned threadCount = options.getThreadCount() == 0 ? getHardwareThreadCount() : options.getThreadCount();
+  collector.setThreadCount(threadCount);
+  collector.setPageSelection([options](unsigned index)
+  {
+    return options.isPageSelected(index);
+  });
+  input->seek(0, librevenge::RVNG_SEEK_SET);
+  std::unique_ptr<MSPUBParser> parser;
+  switch (getVersion(input))
+  {
+  case MSPUB_2K:
+  {
+    std::unique_ptr<librevenge::RVNGInputStream> quillStream(input->getSubStreamByName("Quill/QuillSub/CONTENTS"));
+    if (!quillStream)
+      parser.reset(new MSPUBParser97(input, &collector));
+    else
+      parser.reset(new MSPUBParser2k(input, &collector));
+    break;
+  }
+  case MSPUB_2K2:
+  {
+    parser.reset(new MSPUBParser(input, &collector));
+    break;
+  }
+  default:
+    return false;
+  }
+  if (parser)
+  {
+    parser->setThreadCount(threadCount);
+    parser->setPipelined(options.isPipelined());
+    return parser->parse();
+  }
+  return false;
+}
+
 } // anonymous namespace
 
+struct MSPUBParsedDocument::Impl
+{
+  Impl();
 
+  MSPUBCollector m_collector;
+};
+
+MSPUBParsedDocument::Impl::Impl()
+  : m_collector(nullptr)
+{
+}
 
 /**
 Analyzes the content of an input stream to see if it can be parsed
@@ -117,6 +167,18 @@ RVNGDrawingInterface class implementation when needed. This is often commonly ca
 \return A value that indicates whether the parsing was successful
 */
 PUBAPI bool MSPUBDocument::parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter)
+{
+  return parse(input, painter, MSPUBParseOptions());
+}
+
+/**
+Parses the input stream content, like the function above, using the given settings.
+\param input The input stream
+\param painter A MSPUBPainterInterface implementation
+\param options Settings for the parsing
+\return A value that indicates whether the parsing was successful
+*/
+PUBAPI bool MSPUBDocument::parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter, const MSPUBParseOptions &options)
 {
   if (!input || !painter)
     return false;
@@ -124,39 +186,128 @@ PUBAPI bool MSPUBDocument::parse(librevenge::RVNGInputStream *input, librevenge:
   try
   {
     MSPUBCollector collector(painter);
-    input->seek(0, librevenge::RVNG_SEEK_SET);
-    std::unique_ptr<MSPUBParser> parser;
-    switch (getVersion(input))
-    {
-    case MSPUB_2K:
-    {
-      std::unique_ptr<librevenge::RVNGInputStream> quillStream(input->getSubStreamByName("Quill/QuillSub/CONTENTS"));
-      if (!quillStream)
-        parser.reset(new MSPUBParser97(input, &collector));
-      else
-        parser.reset(new MSPUBParser2k(input, &collector));
-      break;
-    }
-    case MSPUB_2K2:
-    {
-      parser.reset(new MSPUBParser(input, &collector));
-      break;
-    }
-    default:
+    return parseWith(input, collector, options);
+  }
+  catch (...)
+  {
+    return false;
+  }
+}
+
+/**
+Reads only the metadata of a document, i.e. the properties that parse() passes to
+RVNGDrawingInterface::setDocumentMetaData(), without parsing the rest of the document.
+\param input The input stream
+\param metaData The property list that receives the metadata
+\return A value that indicates whether the input stream could be read; false for
+input without the Contents stream of a Publisher document, e.g. other OLE2 documents
+*/
+PUBAPI bool MSPUBDocument::parseMetaData(librevenge::RVNGInputStream *input, librevenge::RVNGPropertyList &metaData)
+{
+  if (!input)
+    return false;
+
+  try
+  {
+    // Only look at the directory here: reading Contents to check its
+    // signature, as getVersion() does, would load the whole stream.
+    if (!input->isStructured() || !input->existsSubStream("Contents"))
       return false;
-    }
-    if (parser)
-    {
-      return parser->parse();
-    }
+
+    MSPUBMetaData reader;
+    if (!reader.parseStorage(input))
+      return false;
+    metaData = reader.getMetaData();
+    return true;
+  }
+  catch (...)
+  {
     return false;
   }
+}
+
+/**
+Parses the input stream content into a document that can be painted later, any number of times.
+The document keeps what it needs from the input, so the input may be destroyed once this returns.
+\param input The input stream
+\return The parsed document, to be deleted by the caller, or nullptr if the parsing failed
+*/
+PUBAPI MSPUBParsedDocument *MSPUBDocument::parseDocument(librevenge::RVNGInputStream *input)
+{
+  return parseDocument(input, MSPUBParseOptions());
+}
+
+/**
+Parses the input stream content into a document, like the function above, using the given settings.
+The thread count and the page selection of the settings also apply when the document is painted.
+\param input The input stream
+\param options Settings for the parsing
+\return The parsed document, to be deleted by the caller, or nullptr if the parsing failed
+*/
+PUBAPI MSPUBParsedDocument *MSPUBDocument::parseDocument(librevenge::RVNGInputStream *input, const MSPUBParseOptions &options)
+{
+  if (!input)
+    return nullptr;
+
+  try
+  {
+    std::unique_ptr<MSPUBParsedDocument::Impl> impl(new MSPUBParsedDocument::Impl());
+    if (!parseWith(input, impl->m_collector, options))
+      return nullptr;
+    return new MSPUBParsedDocument(impl.release());
+  }
+  catch (...)
+  {
+    return nullptr;
+  }
+}
+
+MSPUBParsedDocument::MSPUBParsedDocument(Impl *const impl)
+  : m_impl(impl)
+{
+}
+
+PUBAPI MSPUBParsedDocument::~MSPUBParsedDocument()
+{
+  delete m_impl;
+}
+
+/**
+Paints the document. It will make callbacks to the functions provided by a
+RVNGDrawingInterface class implementation, the same as MSPUBDocument::parse() does.
+\param painter A RVNGDrawingInterface implementation
+\return A value that indicates whether the painting was successful
+*/
+PUBAPI bool MSPUBParsedDocument::render(librevenge::RVNGDrawingInterface *painter) const
+{
+  if (!painter)
+    return false;
+
+  try
+  {
+    return m_impl->m_collector.render(painter);
+  }
   catch (...)
   {
     return false;
   }
 }
 
+PUBAPI unsigned MSPUBParsedDocument::getPageCount() const
+{
+  return m_impl->m_collector.getPageCount();
+}
+
+PUBAPI double MSPUBParsedDocument::getPageWidth() const
+{
+  return m_impl->m_collector.getWidth();
+}
+
+PUBAPI double MSPUBParsedDocument::getPageHeight() const
+{
+  return m_impl->m_collector.getHeight();
+}
+
 }
 
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -13,6 +13,7 @@
 #include <cstdio>
 #include <cstring>
 #include <ctime>
+#include <memory>
 #include <string>
 
 #include "libmspub_utils.h"
@@ -309,7 +310,13 @@ bool libmspub::MSPUBMetaData::parseTimes(librevenge::RVNGInputStream *input)
   // modifiedTime is number of 100ns since Jan 1 1601
   const uint64_t epoch = uint64_t(116444736UL) * 100;
   time_t sec = (modifiedTime / 10000000) - epoch;
-  const struct tm *time = localtime(&sec);
+  // not localtime(), as its result is shared by all threads
+  struct tm localTime;
+#ifdef _WIN32
+  const struct tm *const time = localtime_s(&localTime, &sec) == 0 ? &localTime : nullptr;
+#else
+  const struct tm *const time = localtime_r(&sec, &localTime);
+#endif
   if (time)
   {
     static const int MAX_BUFFER = 1024;
@@ -325,6 +332,32 @@ bool libmspub::MSPUBMetaData::parseTimes(librevenge::RVNGInputStream *input)
   return false;
 }
 
+bool libmspub::MSPUBMetaData::parseStorage(librevenge::RVNGInputStream *input)
+{
+  if (!input || !input->isStructured())
+    return false;
+
+  input->seek(0, librevenge::RVNG_SEEK_SET);
+
+  std::unique_ptr<librevenge::RVNGInputStream> sumaryInfo(input->getSubStreamByName("\x05SummaryInformation"));
+  if (sumaryInfo)
+  {
+    parse(sumaryInfo.get());
+  }
+
+  std::unique_ptr<librevenge::RVNGInputStream> docSumaryInfo(input->getSubStreamByName("\005DocumentSummaryInformation"));
+  if (docSumaryInfo)
+  {
+    parse(docSumaryInfo.get());
+  }
+
+  input->seek(0, librevenge::RVNG_SEEK_SET);
+  parseTimes(input);
+  input->seek(0, librevenge::RVNG_SEEK_SET);
+
+  return true;
+}
+
 const librevenge::RVNGPropertyList &libmspub::MSPUBMetaData::getMetaData()
 {
   return m_metaData;
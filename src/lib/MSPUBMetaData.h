@@ -29,6 +29,8 @@ public:
   ~MSPUBMetaData();
   bool parse(librevenge::RVNGInputStream *input);
   bool parseTimes(librevenge::RVNGInputStream *input);
+  /// Reads the property set streams and the times of a whole structured file.
+  bool parseStorage(librevenge::RVNGInputStream *input);
   const librevenge::RVNGPropertyList &getMetaData();
 
 private:
@@ -0,0 +1,91 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <libmspub/libmspub.h>
+
+#include <set>
+
+namespace libmspub
+{
+
+struct MSPUBParseOptions::Impl
+{
+  Impl();
+
+  unsigned m_threadCount;
+  bool m_pipelined;
+  std::set<unsigned> m_selectedPages;
+};
+
+MSPUBParseOptions::Impl::Impl()
+  : m_threadCount(1)
+  , m_pipelined(false)
+  , m_selectedPages()
+{
+}
+
+PUBAPI MSPUBParseOptions::MSPUBParseOptions()
+  : m_impl(new Impl())
+{
+}
+
+PUBAPI MSPUBParseOptions::MSPUBParseOptions(const MSPUBParseOptions &other)
+  : m_impl(new Impl(*other.m_impl))
+{
+}
+
+PUBAPI MSPUBParseOptions::~MSPUBParseOptions()
+{
+  delete m_impl;
+}
+
+PUBAPI MSPUBParseOptions &MSPUBParseOptions::operator=(const MSPUBParseOptions &other)
+{
+  *m_impl = *other.m_impl;
+  return *this;
+}
+
+PUBAPI void MSPUBParseOptions::setThreadCount(const unsigned count)
+{
+  m_impl->m_threadCount = count;
+}
+
+PUBAPI unsigned MSPUBParseOptions::getThreadCount() const
+{
+  return m_impl->m_threadCount;
+}
+
+PUBAPI void MSPUBParseOptions::setPipelined(const bool pipelined)
+{
+  m_impl->m_pipelined = pipelined;
+}
+
+PUBAPI bool MSPUBParseOptions::isPipelined() const
+{
+  return m_impl->m_pipelined;
+}
+
+PUBAPI void MSPUBParseOptions::selectPage(const unsigned index)
+{
+  m_impl->m_selectedPages.insert(index);
+}
+
+PUBAPI void MSPUBParseOptions::selectAllPages()
+{
+  m_impl->m_selectedPages.clear();
+}
+
+PUBAPI bool MSPUBParseOptions::isPageSelected(const unsigned index) const
+{
+  return m_impl->m_selectedPages.empty() || m_impl->m_selectedPages.find(index) != m_impl->m_selectedPages.end();
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -11,7 +11,7 @@
 
 #include <algorithm>
 #include <cassert>
-#include <list>
+#include <functional>
 #include <memory>
 #include <set>
 #include <sstream>
@@ -38,11 +38,14 @@
 #include "MSPUBConstants.h"
 #include "MSPUBContentChunkType.h"
 #include "MSPUBMetaData.h"
+#include "MemoryStream.h"
+#include "QuillChunkType.h"
 #include "Shadow.h"
 #include "ShapeFlags.h"
 #include "ShapeType.h"
 #include "TableInfo.h"
 #include "VerticalAlign.h"
+#include "WorkerPool.h"
 #include "libmspub_utils.h"
 
 namespace libmspub
@@ -97,20 +100,71 @@ Underline readUnderline(const unsigned value)
   }
 }
 
+/* Text is consumed two bytes at a time, so a span or paragraph boundary
+ * takes effect at the end of the first character that reaches it, and
+ * never at the character that closed the previous one.
+ */
+unsigned long getTextBoundary(const unsigned long target, const unsigned long pos, const unsigned long end)
+{
+  if (target > end)
+    return (unsigned long)-1;
+  if (target <= pos + 2)
+    return pos + 2;
+  return target + (target - pos) % 2;
+}
+
+// Decoding a formatting chunk is cheap, so only start another thread
+// for at least this many of them.
+const std::size_t QUILL_CHUNKS_PER_THREAD = 8;
+// shape chunks are small, so it takes more of them to be worth a thread
+const std::size_t SHAPE_CHUNKS_PER_THREAD = 32;
+
+/** Runs decode(stream, i) for i = 0, ..., count - 1 on at most threadCount threads.
+ *
+ * With more than one thread, input is copied into memory first, and each
+ * call reads through its own view of that copy; otherwise all calls read
+ * input itself. decode must only read from the stream and write to its
+ * own result.
+ */
+void decodeConcurrently(librevenge::RVNGInputStream *const input, const std::size_t count, const unsigned threadCount,
+                        const std::function<void(librevenge::RVNGInputStream *, std::size_t)> &decode)
+{
+  if (threadCount <= 1)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+      decode(input, i);
+    return;
+  }
+
+  std::vector<unsigned char> data;
+  const unsigned long length = getLength(input);
+  input->seek(0, librevenge::RVNG_SEEK_SET);
+  readNBytes(input, length, data);
+  runTasks(count, threadCount, [&](std::size_t i)
+  {
+    MemoryStream view(data.data(), data.size());
+    decode(&view, i);
+  });
+}
+
 }
 
+const unsigned MSPUBParser::ESCHER_ROOT_RECORD;
+const unsigned MSPUBParser::NO_ESCHER_RECORD;
+
 MSPUBParser::MSPUBParser(librevenge::RVNGInputStream *input, MSPUBCollector *collector)
   : m_input(input),
     m_length(boost::numeric_cast<unsigned>(getLength(input))),
     m_collector(collector),
     m_blockInfo(), m_contentChunks(),
-    m_cellsChunkIndices(),
+    m_cellsChunkIndicesBySeqNum(),
     m_pageChunkIndices(), m_shapeChunkIndices(),
     m_paletteChunkIndices(), m_borderArtChunkIndices(),
     m_fontChunkIndices(),
-    m_unknownChunkIndices(), m_documentChunkIndex(),
+    m_unknownChunkIndices(), m_listedShapeSeqNums(), m_documentChunkIndex(),
     m_lastSeenSeqNum(-1), m_lastAddedImage(0),
-    m_alternateShapeSeqNums(), m_escherDelayIndices()
+    m_alternateShapeSeqNums(), m_escherDelayIndices(),
+    m_escherRecords(), m_threadCount(1), m_pipelined(false)
 {
 }
 
@@ -118,6 +172,16 @@ MSPUBParser::~MSPUBParser()
 {
 }
 
+void MSPUBParser::setThreadCount(const unsigned count)
+{
+  m_threadCount = count;
+}
+
+void MSPUBParser::setPipelined(const bool pipelined)
+{
+  m_pipelined = pipelined;
+}
+
 bool MSPUBParser::lineExistsByFlagPointer(unsigned *flags,
                                           unsigned *geomFlags)
 {
@@ -189,11 +253,65 @@ bool MSPUBParser::parse()
     MSPUB_DEBUG_MSG(("Couldn't get quill stream.\n"));
     return false;
   }
+  if (m_pipelined)
+  {
+    // The other streams are read from the storage while the text is
+    // parsed, and substreams of a storage may not be readable
+    // independently of each other. So the Quill stream is read here.
+    std::vector<unsigned char> quillData;
+    readNBytes(quill.get(), getLength(quill.get()), quillData);
+    quill.reset();
+    return parsePipelined(quillData);
+  }
   if (!parseQuill(quill.get()))
   {
     MSPUB_DEBUG_MSG(("Couldn't parse quill stream.\n"));
     return false;
   }
+  if (!parseDocumentStreams())
+    return false;
+
+  return m_collector->go();
+}
+
+bool MSPUBParser::parsePipelined(const std::vector<unsigned char> &quillData)
+{
+  // The Quill stream only provides the text, text styles, fonts and text
+  // colors, which nothing in the other streams uses. So it is parsed into
+  // a collector of its own while the other streams are parsed, and the
+  // results are merged afterwards. The two stages share the threads.
+  MSPUBCollector quillCollector(nullptr);
+  MSPUBParser quillParser(m_input, &quillCollector);
+  const unsigned threadCount = m_threadCount;
+  quillParser.setThreadCount(std::max(1u, threadCount / 2));
+  m_threadCount = std::max(1u, threadCount - threadCount / 2);
+  bool parsedQuill = false;
+  bool parsedDocument = false;
+  runTasks(2, 2, [&](std::size_t stage)
+  {
+    if (stage == 0)
+    {
+      MemoryStream quill(quillData.data(), quillData.size());
+      parsedQuill = quillParser.parseQuill(&quill);
+    }
+    else
+      parsedDocument = parseDocumentStreams();
+  });
+  m_threadCount = threadCount;
+  if (!parsedQuill)
+  {
+    MSPUB_DEBUG_MSG(("Couldn't parse quill stream.\n"));
+    return false;
+  }
+  if (!parsedDocument)
+    return false;
+  m_collector->mergeText(quillCollector);
+
+  return m_collector->go();
+}
+
+bool MSPUBParser::parseDocumentStreams()
+{
   std::unique_ptr<librevenge::RVNGInputStream> contents(m_input->getSubStreamByName("Contents"));
   if (!contents)
   {
@@ -208,7 +326,7 @@ bool MSPUBParser::parse()
   std::unique_ptr<librevenge::RVNGInputStream> escherDelay(m_input->getSubStreamByName("Escher/EscherDelayStm"));
   if (escherDelay)
   {
-    parseEscherDelay(escherDelay.get());
+    parseEscherDelay(std::move(escherDelay));
   }
   std::unique_ptr<librevenge::RVNGInputStream> escher(m_input->getSubStreamByName("Escher/EscherStm"));
   if (!escher)
@@ -222,7 +340,7 @@ bool MSPUBParser::parse()
     return false;
   }
 
-  return m_collector->go();
+  return true;
 }
 
 ImgType MSPUBParser::imgTypeByBlipType(unsigned short type)
@@ -290,75 +408,35 @@ int MSPUBParser::getStartOffset(ImgType type, unsigned short initial)
   return offset + (oneUid ? 0 : 0x10);
 }
 
-bool MSPUBParser::parseEscherDelay(librevenge::RVNGInputStream *input)
+bool MSPUBParser::parseEscherDelay(std::unique_ptr<librevenge::RVNGInputStream> input)
 {
-  while (stillReading(input, (unsigned long)-1))
+  const unsigned long length = getLength(input.get());
+  while (stillReading(input.get(), (unsigned long)-1))
   {
-    EscherContainerInfo info = parseEscherContainer(input);
+    EscherContainerInfo info = parseEscherContainer(input.get());
     const ImgType imgType = imgTypeByBlipType(info.type);
     if (imgType != UNKNOWN)
     {
-      librevenge::RVNGBinaryData img;
-      unsigned long toRead = info.contentsLength;
-      input->seek(input->tell() + getStartOffset(imgType, info.initial), librevenge::RVNG_SEEK_SET);
-      while (toRead > 0 && stillReading(input, (unsigned long)-1))
-      {
-        unsigned long howManyRead = 0;
-        const unsigned char *buf = input->read(toRead, howManyRead);
-        img.append(buf, howManyRead);
-        toRead -= howManyRead;
-      }
-      if (imgType == WMF || imgType == EMF)
+      const unsigned long start = input->tell() + getStartOffset(imgType, info.initial);
+      const unsigned long available = start < length ? std::min<unsigned long>(info.contentsLength, length - start) : 0;
+      if (imgType == DIB && available < 0x2E + 4)
       {
-        img = inflateData(img);
+        ++m_lastAddedImage;
+        MSPUB_DEBUG_MSG(("Garbage DIB at index 0x%x\n", m_lastAddedImage));
       }
-      else if (imgType == DIB)
+      else
       {
-        // Reconstruct BMP header
-        // cf. http://en.wikipedia.org/wiki/BMP_file_format , accessed 2012-5-31
-        librevenge::RVNGInputStream *buf = img.getDataStream();
-        if (img.size() < 0x2E + 4)
-        {
-          ++m_lastAddedImage;
-          MSPUB_DEBUG_MSG(("Garbage DIB at index 0x%x\n", m_lastAddedImage));
-          input->seek(info.contentsOffset + info.contentsLength, librevenge::RVNG_SEEK_SET);
-          continue;
-        }
-        buf->seek(0x0E, librevenge::RVNG_SEEK_SET);
-        unsigned short bitsPerPixel = readU16(buf);
-        buf->seek(0x20, librevenge::RVNG_SEEK_SET);
-        unsigned numPaletteColors = readU32(buf);
-        if (numPaletteColors == 0 && bitsPerPixel <= 8)
+        unsigned long decodedSize = 0;
+        // The metafile header ends with the uncompressed size, the bounds,
+        // the size in EMUs, the compressed size, compression and filter
+        // (0x22 bytes), followed by the 2 byte zlib header we skip.
+        if ((imgType == WMF || imgType == EMF) && start >= info.contentsOffset + 0x24)
         {
-          numPaletteColors = 1;
-          for (int i = 0; i < bitsPerPixel; ++i)
-          {
-            numPaletteColors *= 2;
-          }
+          input->seek(start - 0x24, librevenge::RVNG_SEEK_SET);
+          decodedSize = readU32(input.get());
         }
-
-        librevenge::RVNGBinaryData tmpImg;
-        tmpImg.append((unsigned char)0x42);
-        tmpImg.append((unsigned char)0x4d);
-
-        tmpImg.append((unsigned char)((img.size() + 14) & 0x000000ff));
-        tmpImg.append((unsigned char)(((img.size() + 14) & 0x0000ff00) >> 8));
-        tmpImg.append((unsigned char)(((img.size() + 14) & 0x00ff0000) >> 16));
-        tmpImg.append((unsigned char)(((img.size() + 14) & 0xff000000) >> 24));
-
-        tmpImg.append((unsigned char)0x00);
-        tmpImg.append((unsigned char)0x00);
-        tmpImg.append((unsigned char)0x00);
-        tmpImg.append((unsigned char)0x00);
-
-        tmpImg.append((unsigned char)(0x36 + 4 * numPaletteColors));
-        tmpImg.append((unsigned char)0x00);
-        tmpImg.append((unsigned char)0x00);
-        tmpImg.append((unsigned char)0x00);
-        tmpImg.append(img);
-        img = tmpImg;
+        m_collector->addDelayedImage(++m_lastAddedImage, imgType, start, available, decodedSize);
       }
-      m_collector->addImage(++m_lastAddedImage, imgType, img);
     }
     else
     {
@@ -367,6 +445,8 @@ bool MSPUBParser::parseEscherDelay(librevenge::RVNGInputStream *input)
     }
     input->seek(info.contentsOffset + info.contentsLength, librevenge::RVNG_SEEK_SET);
   }
+  // the images are read from the stream when they are first drawn
+  m_collector->setImageStream(std::move(input));
   return true;
 }
 
@@ -429,36 +509,32 @@ bool MSPUBParser::parseContents(librevenge::RVNGInputStream *input)
           return false;
         }
       }
-      for (unsigned int shapeChunkIndex : m_shapeChunkIndices)
+      input->seek(documentChunk.offset, librevenge::RVNG_SEEK_SET);
+      if (!parseDocumentChunk(input, documentChunk))
       {
-        const ContentChunkReference &shapeChunk =
-          m_contentChunks.at(shapeChunkIndex);
-        input->seek(shapeChunk.offset, librevenge::RVNG_SEEK_SET);
-        if (!parseShape(input, shapeChunk))
-        {
-          return false;
-        }
+        return false;
       }
-      for (unsigned int fontChunkIndex : m_fontChunkIndices)
+      // the pages go before the shapes, as they tell which shapes are listed
+      for (unsigned int pageChunkIndex : m_pageChunkIndices)
       {
-        const ContentChunkReference &fontChunk =
-          m_contentChunks.at(fontChunkIndex);
-        input->seek(fontChunk.offset, librevenge::RVNG_SEEK_SET);
-        if (!parseFontChunk(input, fontChunk))
+        const ContentChunkReference &pageChunk = m_contentChunks.at(pageChunkIndex);
+        input->seek(pageChunk.offset, librevenge::RVNG_SEEK_SET);
+        if (!parsePageChunk(input, pageChunk))
         {
           return false;
         }
       }
-      input->seek(documentChunk.offset, librevenge::RVNG_SEEK_SET);
-      if (!parseDocumentChunk(input, documentChunk))
+      dropUnreachableShapeChunks();
+      if (!parseShapeChunks(input))
       {
         return false;
       }
-      for (unsigned int pageChunkIndex : m_pageChunkIndices)
+      for (unsigned int fontChunkIndex : m_fontChunkIndices)
       {
-        const ContentChunkReference &pageChunk = m_contentChunks.at(pageChunkIndex);
-        input->seek(pageChunk.offset, librevenge::RVNG_SEEK_SET);
-        if (!parsePageChunk(input, pageChunk))
+        const ContentChunkReference &fontChunk =
+          m_contentChunks.at(fontChunkIndex);
+        input->seek(fontChunk.offset, librevenge::RVNG_SEEK_SET);
+        if (!parseFontChunk(input, fontChunk))
         {
           return false;
         }
@@ -542,15 +618,15 @@ bool MSPUBParser::parseFontChunk(
             if (subSubInfo.id == EMBEDDED_FONT_NAME)
             {
               name = librevenge::RVNGString();
+              const ByteSpan nameData = readBlockString(input, subSubInfo);
               // drop trailing 0
               // TODO: This could be a general problem. Check.
-              const std::size_t len = subSubInfo.stringData.size();
-              if ((len > 2) && (subSubInfo.stringData[len - 1] == 0) && (subSubInfo.stringData[len - 2] == 0))
+              std::size_t len = nameData.size();
+              if ((len > 2) && (nameData[len - 1] == 0) && (nameData[len - 2] == 0))
               {
-                subSubInfo.stringData.pop_back();
-                subSubInfo.stringData.pop_back();
+                len -= 2;
               }
-              appendCharacters(name.get(), subSubInfo.stringData, "UTF-16LE");
+              appendCharacters(name.get(), nameData.data(), len, "UTF-16LE");
             }
             else if (subSubInfo.id == EMBEDDED_EOT)
             {
@@ -612,14 +688,7 @@ bool MSPUBParser::parseBorderArtChunk(
                 {
                   librevenge::RVNGBinaryData &img = *(m_collector->addBorderImage(
                                                         WMF, i));
-                  unsigned long toRead = imgRecord.dataLength;
-                  while (toRead > 0 && stillReading(input, (unsigned long)-1))
-                  {
-                    unsigned long howManyRead = 0;
-                    const unsigned char *buf = input->read(toRead, howManyRead);
-                    img.append(buf, howManyRead);
-                    toRead -= howManyRead;
-                  }
+                  readBinaryData(input, imgRecord.dataLength, img);
                 }
               }
             }
@@ -661,6 +730,8 @@ bool MSPUBParser::parsePageChunk(librevenge::RVNGInputStream *input, const Conte
     if (info.id == PAGE_BG_SHAPE)
     {
       m_collector->setPageBgShape(chunk.seqNum, info.data);
+      if (type != DUMMY_PAGE)
+        m_listedShapeSeqNums.insert(info.data);
     }
     else if (info.id == PAGE_SHAPES)
     {
@@ -668,11 +739,13 @@ bool MSPUBParser::parsePageChunk(librevenge::RVNGInputStream *input, const Conte
     }
     else if (info.id == THIS_MASTER_NAME)
     {
-      for (unsigned char i : info.stringData)
+      const ByteSpan masterName = readBlockString(input, info);
+      for (std::size_t i = 0; i < masterName.size(); ++i)
       {
-        if (i != 0)
+        if (masterName[i] != 0)
         {
           m_collector->designateMasterPage(chunk.seqNum);
+          break;
         }
       }
     }
@@ -697,13 +770,15 @@ bool MSPUBParser::parsePageShapeList(librevenge::RVNGInputStream *input, MSPUBBl
     if (subInfo.type == SHAPE_SEQNUM)
     {
       m_collector->setShapePage(subInfo.data, pageSeqNum);
+      if (getPageTypeBySeqNum(pageSeqNum) != DUMMY_PAGE)
+        m_listedShapeSeqNums.insert(subInfo.data);
     }
   }
   return true;
 }
 
-bool MSPUBParser::parseShape(librevenge::RVNGInputStream *input,
-                             const ContentChunkReference &chunk)
+bool MSPUBParser::decodeShapeChunk(librevenge::RVNGInputStream *input,
+                                   const ContentChunkReference &chunk, ShapeChunkData &data)
 {
   MSPUB_DEBUG_MSG(("parseShape: seqNum 0x%x\n", chunk.seqNum));
   unsigned long pos = input->tell();
@@ -775,15 +850,7 @@ bool MSPUBParser::parseShape(librevenge::RVNGInputStream *input,
         MSPUB_DEBUG_MSG(("ERROR: Wrong number of rows or columns found in table definition.\n"));
         return false;
       }
-      boost::optional<unsigned> index;
-      for (size_t i = 0; i < m_cellsChunkIndices.size(); ++i)
-      {
-        if (m_contentChunks[m_cellsChunkIndices[i]].seqNum == csn)
-        {
-          index = i;
-          break;
-        }
-      }
+      const unsigned *const index = getIfExists_const(m_cellsChunkIndicesBySeqNum, csn);
 
       TableInfo ti(nr, nc);
       ti.m_rowHeightsInEmu = rowHeightsInEmu;
@@ -797,7 +864,7 @@ bool MSPUBParser::parseShape(librevenge::RVNGInputStream *input,
       }
       else
       {
-        const ContentChunkReference &cellsChunk = m_contentChunks[m_cellsChunkIndices[get(index)]];
+        const ContentChunkReference &cellsChunk = m_contentChunks[*index];
         input->seek(cellsChunk.offset, librevenge::RVNG_SEEK_SET);
         const unsigned cellsLength = readU32(input);
         boost::optional<unsigned> cellCount;
@@ -858,9 +925,8 @@ bool MSPUBParser::parseShape(librevenge::RVNGInputStream *input,
         }
       }
 
-      m_collector->setShapeTableInfo(chunk.seqNum, ti);
-      if (bool(textId))
-        m_collector->addTextShape(get(textId), chunk.seqNum);
+      data.tableInfo = ti;
+      data.textId = textId;
       return true;
     }
     return false;
@@ -885,7 +951,7 @@ bool MSPUBParser::parseShape(librevenge::RVNGInputStream *input,
       }
       else if (info.id == SHAPE_BORDER_IMAGE_ID)
       {
-        m_collector->setShapeBorderImageId(chunk.seqNum, info.data);
+        data.borderImageId = info.data;
       }
       else if (info.id == SHAPE_DONT_STRETCH_BA)
       {
@@ -898,19 +964,14 @@ bool MSPUBParser::parseShape(librevenge::RVNGInputStream *input,
       }
       else if (info.id == SHAPE_VALIGN)
       {
-        m_collector->setShapeVerticalTextAlign(chunk.seqNum,
-                                               static_cast<VerticalAlign>(info.data));
+        data.verticalAlign = static_cast<VerticalAlign>(info.data);
       }
       else if (info.id == SHAPE_CROP && info.data != 0)
       {
-        m_collector->setShapeCropType(chunk.seqNum,
-                                      static_cast<ShapeType>(info.data));
+        data.cropType = static_cast<ShapeType>(info.data);
       }
     }
-    if (shouldStretchBorderArt)
-    {
-      m_collector->setShapeStretchBorderArt(chunk.seqNum);
-    }
+    data.stretchBorderArt = shouldStretchBorderArt;
     bool parseWithoutDimensions = true; //FIXME: Should we ever ignore if height and width not given?
     if (isGroup || (height > 0 && width > 0) || parseWithoutDimensions)
     {
@@ -918,7 +979,7 @@ bool MSPUBParser::parseShape(librevenge::RVNGInputStream *input,
       {
         if (isText)
         {
-          m_collector->addTextShape(textId, chunk.seqNum);
+          data.textId = textId;
         }
       }
     }
@@ -930,6 +991,73 @@ bool MSPUBParser::parseShape(librevenge::RVNGInputStream *input,
   }
 }
 
+void MSPUBParser::commitShapeChunk(const ContentChunkReference &chunk, const ShapeChunkData &data)
+{
+  if (bool(data.tableInfo))
+    m_collector->setShapeTableInfo(chunk.seqNum, get(data.tableInfo));
+  if (bool(data.borderImageId))
+    m_collector->setShapeBorderImageId(chunk.seqNum, get(data.borderImageId));
+  if (bool(data.verticalAlign))
+    m_collector->setShapeVerticalTextAlign(chunk.seqNum, get(data.verticalAlign));
+  if (bool(data.cropType))
+    m_collector->setShapeCropType(chunk.seqNum, get(data.cropType));
+  if (data.stretchBorderArt)
+    m_collector->setShapeStretchBorderArt(chunk.seqNum);
+  if (bool(data.textId))
+    m_collector->addTextShape(get(data.textId), chunk.seqNum);
+}
+
+void MSPUBParser::dropUnreachableShapeChunks()
+{
+  // Only the chunks that are clearly never painted are dropped: alternate
+  // shapes and the shapes in the scratch area of the dummy pages, unless
+  // a page lists them. Other chunks can't be judged by their parent, as
+  // not every chunk names one.
+  std::set<unsigned> dummyPages;
+  for (unsigned int pageChunkIndex : m_pageChunkIndices)
+  {
+    const unsigned seqNum = m_contentChunks.at(pageChunkIndex).seqNum;
+    if (getPageTypeBySeqNum(seqNum) == DUMMY_PAGE)
+      dummyPages.insert(seqNum);
+  }
+
+  std::vector<unsigned> reachableChunkIndices;
+  reachableChunkIndices.reserve(m_shapeChunkIndices.size());
+  for (unsigned int shapeChunkIndex : m_shapeChunkIndices)
+  {
+    const ContentChunkReference &shapeChunk = m_contentChunks.at(shapeChunkIndex);
+    const bool listed = m_listedShapeSeqNums.find(shapeChunk.seqNum) != m_listedShapeSeqNums.end();
+    // if no page lists any shape, there is nothing to go by for the alternate shapes
+    const bool unlistedAlternate = shapeChunk.type == ALTSHAPE && !listed && !m_listedShapeSeqNums.empty();
+    const bool inScratchArea = dummyPages.find(shapeChunk.parentSeqNum) != dummyPages.end() && !listed;
+    if (!unlistedAlternate && !inScratchArea)
+      reachableChunkIndices.push_back(shapeChunkIndex);
+  }
+  MSPUB_DEBUG_MSG(("Skipping %u unreachable shape chunks\n", unsigned(m_shapeChunkIndices.size() - reachableChunkIndices.size())));
+  m_shapeChunkIndices.swap(reachableChunkIndices);
+}
+
+bool MSPUBParser::parseShapeChunks(librevenge::RVNGInputStream *input)
+{
+  const unsigned threadCount = unsigned(std::min<std::size_t>(m_threadCount, m_shapeChunkIndices.size() / SHAPE_CHUNKS_PER_THREAD));
+  std::vector<ShapeChunkData> data(m_shapeChunkIndices.size());
+  std::vector<char> decoded(m_shapeChunkIndices.size(), 0);
+  decodeConcurrently(input, m_shapeChunkIndices.size(), threadCount, [&](librevenge::RVNGInputStream *stream, std::size_t i)
+  {
+    const ContentChunkReference &shapeChunk = m_contentChunks.at(m_shapeChunkIndices[i]);
+    stream->seek(shapeChunk.offset, librevenge::RVNG_SEEK_SET);
+    decoded[i] = decodeShapeChunk(stream, shapeChunk, data[i]);
+  });
+  // commit in chunk order, stopping at the first chunk that failed to decode
+  for (std::size_t i = 0; i < m_shapeChunkIndices.size(); ++i)
+  {
+    if (!decoded[i])
+      return false;
+    commitShapeChunk(m_contentChunks.at(m_shapeChunkIndices[i]), data[i]);
+  }
+  return true;
+}
+
 QuillChunkReference MSPUBParser::parseQuillChunkReference(librevenge::RVNGInputStream *input)
 {
   QuillChunkReference ret;
@@ -941,6 +1069,7 @@ QuillChunkReference MSPUBParser::parseQuillChunkReference(librevenge::RVNGInputS
   }
   name[4] = '\0';
   ret.name = name;
+  ret.type = MSPUB_FOURCC(name[0], name[1], name[2], name[3]);
   ret.id = readU16(input);
   input->seek(input->tell() + 4, librevenge::RVNG_SEEK_SET); //Seek past what is normally 0x01000000. We don't know what this represents.
   char name2[5];
@@ -973,11 +1102,50 @@ std::vector<unsigned> MSPUBParser::parseTableCellDefinitions(
   return ret;
 }
 
+void MSPUBParser::decodeQuillChunk(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk, QuillChunkData &data)
+{
+  // NOTE: this may run on several threads at once, so it must only
+  // read from input and write to data.
+  input->seek(chunk.offset, librevenge::RVNG_SEEK_SET);
+  switch (chunk.type)
+  {
+  case QUILL_FDPC:
+    data.spans = parseCharacterStyles(input, chunk, data.charStyles);
+    break;
+  case QUILL_FDPP:
+    data.paras = parseParagraphStyles(input, chunk, data.paraStyles);
+    break;
+  case QUILL_STSH:
+    parseDefaultStyle(input, chunk, data.defaultCharStyles, data.defaultParaStyles);
+    break;
+  case QUILL_FONT:
+    data.fonts = parseFonts(input, chunk);
+    break;
+  case QUILL_TCD:
+    data.tableCellTextEnds = parseTableCellDefinitions(input, chunk);
+    break;
+  default:
+    break;
+  }
+}
+
+void MSPUBParser::decodeQuillChunks(librevenge::RVNGInputStream *input, const std::vector<QuillChunkReference> &chunks,
+                                    std::vector<QuillChunkData> &data)
+{
+  data.clear();
+  data.resize(chunks.size());
+  const unsigned threadCount = unsigned(std::min<std::size_t>(m_threadCount, chunks.size() / QUILL_CHUNKS_PER_THREAD));
+  decodeConcurrently(input, chunks.size(), threadCount, [&](librevenge::RVNGInputStream *stream, std::size_t i)
+  {
+    decodeQuillChunk(stream, chunks[i], data[i]);
+  });
+}
+
 bool MSPUBParser::parseQuill(librevenge::RVNGInputStream *input)
 {
   MSPUB_DEBUG_MSG(("MSPUBParser::parseQuill\n"));
   unsigned chunkReferenceListOffset = 0x18;
-  std::list<QuillChunkReference> chunkReferences;
+  std::vector<QuillChunkReference> chunkReferences;
   std::set<unsigned> readChunks; // guard against cycle in the chunk list
   while (chunkReferenceListOffset != 0xffffffff)
   {
@@ -997,8 +1165,34 @@ bool MSPUBParser::parseQuill(librevenge::RVNGInputStream *input)
     }
   }
   MSPUB_DEBUG_MSG(("Found %u Quill chunks\n", (unsigned)chunkReferences.size()));
+
+  // The formatting chunks do not depend on each other, so decode them all
+  // first; their results are added to the collector in directory order below.
+  std::vector<QuillChunkReference> formattingChunks;
+  unsigned whichStsh = 0;
+  for (const auto &chunkReference : chunkReferences)
+  {
+    switch (chunkReference.type)
+    {
+    case QUILL_FDPC:
+    case QUILL_FDPP:
+    case QUILL_FONT:
+    case QUILL_TCD:
+      formattingChunks.push_back(chunkReference);
+      break;
+    case QUILL_STSH:
+      if (whichStsh++ == 1)
+        formattingChunks.push_back(chunkReference);
+      break;
+    default:
+      break;
+    }
+  }
+  std::vector<QuillChunkData> formattingData;
+  decodeQuillChunks(input, formattingChunks, formattingData);
+
   //Make sure we parse the STRS chunk before the TEXT chunk
-  std::list<QuillChunkReference>::const_iterator textChunkReference = chunkReferences.end();
+  const QuillChunkReference *textChunkReference = nullptr;
   bool parsedStrs = false;
   bool parsedSyid = false;
   bool parsedFdpc = false;
@@ -1012,18 +1206,20 @@ bool MSPUBParser::parseQuill(librevenge::RVNGInputStream *input)
   unsigned textOffsetAccum = 0;
   std::vector<TextSpanReference> spans;
   std::vector<TextParagraphReference> paras;
-  unsigned whichStsh = 0;
-  for (std::list<QuillChunkReference>::const_iterator i = chunkReferences.begin(); i != chunkReferences.end(); ++i)
+  std::vector<QuillChunkData>::iterator decoded = formattingData.begin();
+  whichStsh = 0;
+  for (const auto &chunkReference : chunkReferences)
   {
-    if (i->name == "TEXT")
+    switch (chunkReference.type)
     {
-      textChunkReference = i;
-    }
-    else if (i->name == "STRS")
+    case QUILL_TEXT:
+      textChunkReference = &chunkReference;
+      break;
+    case QUILL_STRS:
     {
-      input->seek(i->offset, librevenge::RVNG_SEEK_SET);
+      input->seek(chunkReference.offset, librevenge::RVNG_SEEK_SET);
       unsigned numLengths = readU32(input); //Assuming the first DWORD is the number of children and that the next is the remaining length before children start. We are unsure that this is correct.
-      input->seek(4 + i->offset + readU32(input), librevenge::RVNG_SEEK_SET);
+      input->seek(4 + chunkReference.offset + readU32(input), librevenge::RVNG_SEEK_SET);
       for (unsigned j = 0; j < numLengths; ++j)
       {
         unsigned length = readU32(input);
@@ -1032,10 +1228,11 @@ bool MSPUBParser::parseQuill(librevenge::RVNGInputStream *input)
         textOffsetAccum += length * 2;
       }
       parsedStrs = true;
+      break;
     }
-    else if (i->name == "SYID")
+    case QUILL_SYID:
     {
-      input->seek(i->offset, librevenge::RVNG_SEEK_SET);
+      input->seek(chunkReference.offset, librevenge::RVNG_SEEK_SET);
       readU32(input); // Don't know what the first DWORD means.
       unsigned numIDs = readU32(input);
       for (unsigned j = 0; j < numIDs; ++j)
@@ -1043,51 +1240,77 @@ bool MSPUBParser::parseQuill(librevenge::RVNGInputStream *input)
         textIDs.push_back(readU32(input));
       }
       parsedSyid = true;
+      break;
     }
-    else if (i->name == "PL  ")
-    {
-      input->seek(i->offset, librevenge::RVNG_SEEK_SET);
-      parseColors(input, *i);
-    }
-    else if (i->name == "FDPC")
+    case QUILL_PL:
+      input->seek(chunkReference.offset, librevenge::RVNG_SEEK_SET);
+      parseColors(input, chunkReference);
+      break;
+    case QUILL_FDPC:
     {
-      input->seek(i->offset, librevenge::RVNG_SEEK_SET);
-      std::vector<TextSpanReference> thisBlockSpans = parseCharacterStyles(input, *i);
-      spans.insert(spans.end(), thisBlockSpans.begin(), thisBlockSpans.end());
-      parsedFdpc |= !thisBlockSpans.empty();
+      std::vector<unsigned> styleIds;
+      styleIds.reserve(decoded->charStyles.size());
+      for (auto &style : decoded->charStyles)
+      {
+        style.colorIndex = getColorIndexByQuillEntry(style.colorIndex);
+        styleIds.push_back(m_collector->addCharacterStyle(style));
+      }
+      for (auto &span : decoded->spans)
+      {
+        span.charStyleId = styleIds[span.charStyleId];
+        spans.push_back(span);
+      }
+      parsedFdpc |= !decoded->spans.empty();
+      ++decoded;
+      break;
     }
-    else if (i->name == "FDPP")
+    case QUILL_FDPP:
     {
-      input->seek(i->offset, librevenge::RVNG_SEEK_SET);
-      std::vector<TextParagraphReference> thisBlockParas = parseParagraphStyles(input, *i);
-      paras.insert(paras.end(), thisBlockParas.begin(), thisBlockParas.end());
-      parsedFdpp |= !thisBlockParas.empty();
+      std::vector<unsigned> styleIds;
+      styleIds.reserve(decoded->paraStyles.size());
+      for (const auto &style : decoded->paraStyles)
+        styleIds.push_back(m_collector->addParagraphStyle(style));
+      for (auto &para : decoded->paras)
+      {
+        para.paraStyleId = styleIds[para.paraStyleId];
+        paras.push_back(para);
+      }
+      parsedFdpp |= !decoded->paras.empty();
+      ++decoded;
+      break;
     }
-    else if (i->name == "STSH")
-    {
+    case QUILL_STSH:
       if (whichStsh++ == 1)
       {
-        input->seek(i->offset, librevenge::RVNG_SEEK_SET);
-        parseDefaultStyle(input, *i);
+        for (auto &style : decoded->defaultCharStyles)
+        {
+          style.colorIndex = getColorIndexByQuillEntry(style.colorIndex);
+          m_collector->addDefaultCharacterStyle(style);
+        }
+        for (const auto &style : decoded->defaultParaStyles)
+          m_collector->addDefaultParagraphStyle(style);
         parsedStsh = true;
+        ++decoded;
       }
-    }
-    else if (i->name == "FONT")
-    {
-      input->seek(i->offset, librevenge::RVNG_SEEK_SET);
-      parseFonts(input, *i);
+      break;
+    case QUILL_FONT:
+      for (const auto &font : decoded->fonts)
+        m_collector->addFont(font);
       parsedFont = true;
-    }
-    else if (i->name == "TCD ")
-    {
-      input->seek(i->offset, librevenge::RVNG_SEEK_SET);
-      tableCellTextEnds[i->id] = parseTableCellDefinitions(input, *i);
+      ++decoded;
+      break;
+    case QUILL_TCD:
+      tableCellTextEnds[chunkReference.id] = decoded->tableCellTextEnds;
+      ++decoded;
+      break;
+    default:
+      break;
     }
   }
-  if (parsedStrs && parsedSyid && parsedFdpc && parsedFdpp && parsedStsh && parsedFont && textChunkReference != chunkReferences.end())
+  if (parsedStrs && parsedSyid && parsedFdpc && parsedFdpp && parsedStsh && parsedFont && textChunkReference)
   {
     input->seek(textChunkReference->offset, librevenge::RVNG_SEEK_SET);
-    unsigned bytesRead = 0;
+    unsigned long bytesRead = 0;
     auto currentTextSpan = spans.begin();
     auto currentTextPara = paras.begin();
     for (unsigned j = 0; j < textIDs.size() && j < textLengths.size(); ++j)
@@ -1095,48 +1318,55 @@ bool MSPUBParser::parseQuill(librevenge::RVNGInputStream *input)
       MSPUB_DEBUG_MSG(("Parsing a text block.\n"));
       std::vector<TextParagraph> readParas;
       std::vector<TextSpan> readSpans;
-      std::vector<unsigned char> text;
-      for (unsigned k = 0; k < textLengths[j] && currentTextPara != paras.end() && currentTextSpan != spans.end(); ++k)
+      const unsigned long blockStart = bytesRead;
+      const unsigned long blockEnd = blockStart + 2ul * textLengths[j];
+      const unsigned char *block = nullptr;
+      unsigned long blockAvailable = 0;
+      if (blockEnd > blockStart && currentTextPara != paras.end() && currentTextSpan != spans.end())
+        block = input->read(blockEnd - blockStart, blockAvailable);
+      unsigned long textStart = blockStart;
+      while (bytesRead < blockEnd && currentTextPara != paras.end() && currentTextSpan != spans.end())
       {
-        text.push_back(readU8(input));
-        text.push_back(readU8(input));
-        bytesRead += 2;
-        if (bytesRead >= currentTextSpan->last - textChunkReference->offset)
+        const unsigned long spanEnd = getTextBoundary(currentTextSpan->last - textChunkReference->offset, bytesRead, blockEnd);
+        const unsigned long paraEnd = getTextBoundary(currentTextPara->last - textChunkReference->offset, bytesRead, blockEnd);
+        bytesRead = std::min(std::min(spanEnd, paraEnd), blockEnd);
+        if (bytesRead - blockStart > blockAvailable)
+          throw EndOfStreamException();
+        if (bytesRead == spanEnd)
         {
-          if (!text.empty())
+          if (textStart < bytesRead)
           {
-            readSpans.push_back(TextSpan(text, currentTextSpan->charStyle));
+            readSpans.push_back(TextSpan(ByteSpan(block + (textStart - blockStart), bytesRead - textStart), currentTextSpan->charStyleId));
             MSPUB_DEBUG_MSG(("Saw text span %d in the current text paragraph.\n", (unsigned)readSpans.size()));
           }
           ++currentTextSpan;
-          text.clear();
+          textStart = bytesRead;
         }
-        if (bytesRead >= currentTextPara->last - textChunkReference->offset)
+        if (bytesRead == paraEnd)
         {
-          if (!text.empty())
+          if (textStart < bytesRead)
           {
-            readSpans.push_back(TextSpan(text, currentTextSpan->charStyle));
+            readSpans.push_back(TextSpan(ByteSpan(block + (textStart - blockStart), bytesRead - textStart), currentTextSpan->charStyleId));
             MSPUB_DEBUG_MSG(("Saw text span %d in the current text paragraph.\n", (unsigned)readSpans.size()));
           }
-          text.clear();
+          textStart = bytesRead;
           if (!readSpans.empty())
           {
-            readParas.push_back(TextParagraph(readSpans, currentTextPara->paraStyle));
+            readParas.push_back(TextParagraph(readSpans, currentTextPara->paraStyleId));
             MSPUB_DEBUG_MSG(("Saw paragraph %d in the current text block.\n", (unsigned)readParas.size()));
           }
           ++currentTextPara;
           readSpans.clear();
         }
       }
-      if (!text.empty() && currentTextSpan != spans.end())
+      if (textStart < bytesRead && currentTextSpan != spans.end())
       {
-        readSpans.push_back(TextSpan(text, currentTextSpan->charStyle));
+        readSpans.push_back(TextSpan(ByteSpan(block + (textStart - blockStart), bytesRead - textStart), currentTextSpan->charStyleId));
         MSPUB_DEBUG_MSG(("Saw text span %d in the current text paragraph.\n", (unsigned)readSpans.size()));
       }
-      text.clear();
       if (!readSpans.empty() && currentTextPara != paras.end())
       {
-        readParas.push_back(TextParagraph(readSpans, currentTextPara->paraStyle));
+        readParas.push_back(TextParagraph(readSpans, currentTextPara->paraStyleId));
         MSPUB_DEBUG_MSG(("Saw paragraph %d in the current text block.\n", (unsigned)readParas.size()));
       }
       m_collector->addTextString(readParas, textIDs[j]);
@@ -1145,13 +1375,13 @@ bool MSPUBParser::parseQuill(librevenge::RVNGInputStream *input)
       if (it != tableCellTextEnds.end())
         m_collector->setTableCellTextEnds(textIDs[j], it->second);
     }
-    textChunkReference = chunkReferences.end();
   }
   return true;
 }
 
-void MSPUBParser::parseFonts(librevenge::RVNGInputStream *input, const QuillChunkReference &)
+std::vector<std::vector<unsigned char> > MSPUBParser::parseFonts(librevenge::RVNGInputStream *input, const QuillChunkReference &)
 {
+  std::vector<std::vector<unsigned char> > fonts;
   readU32(input);
   unsigned numElements = readU32(input);
   input->seek(input->tell() + 12 + 4 * numElements, librevenge::RVNG_SEEK_SET);
@@ -1160,15 +1390,16 @@ void MSPUBParser::parseFonts(librevenge::RVNGInputStream *input, const QuillChun
     unsigned short nameLength = readU16(input);
     if (nameLength > 0)
     {
-      std::vector<unsigned char> name;
-      readNBytes(input, nameLength * 2, name);
-      m_collector->addFont(name);
+      fonts.push_back(std::vector<unsigned char>());
+      readNBytes(input, nameLength * 2, fonts.back());
     }
     readU32(input);
   }
+  return fonts;
 }
 
-void MSPUBParser::parseDefaultStyle(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk)
+void MSPUBParser::parseDefaultStyle(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk,
+                                    std::vector<CharacterStyle> &charStyles, std::vector<ParagraphStyle> &paraStyles)
 {
   readU32(input);
   unsigned numElements = std::min(readU32(input), m_length);
@@ -1186,11 +1417,11 @@ void MSPUBParser::parseDefaultStyle(librevenge::RVNGInputStream *input, const Qu
     if (i % 2 == 0)
     {
       //FIXME: Does STSH2 hold information for associating style indices in FDPP to indices in STSH1 ?
-      m_collector->addDefaultCharacterStyle(getCharacterStyle(input));
+      charStyles.push_back(getCharacterStyle(input));
     }
     else
     {
-      m_collector->addDefaultParagraphStyle(getParagraphStyle(input));
+      paraStyles.push_back(getParagraphStyle(input));
     }
   }
 }
@@ -1215,7 +1446,8 @@ void MSPUBParser::parseColors(librevenge::RVNGInputStream *input, const QuillChu
   }
 }
 
-std::vector<MSPUBParser::TextParagraphReference> MSPUBParser::parseParagraphStyles(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk)
+std::vector<MSPUBParser::TextParagraphReference> MSPUBParser::parseParagraphStyles(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk,
+                                                                                 std::vector<ParagraphStyle> &styles)
 {
   std::vector<TextParagraphReference> ret;
   unsigned short numEntries = readU16(input);
@@ -1232,18 +1464,25 @@ std::vector<MSPUBParser::TextParagraphReference> MSPUBParser::parseParagraphStyl
   {
     chunkOffsets.push_back(readU16(input));
   }
+  // many entries usually share the same style record
+  std::map<unsigned short, unsigned> stylesByChunkOffset;
   unsigned currentSpanBegin = 0;
   for (unsigned short i = 0; i < numEntries; ++i)
   {
-    input->seek(chunk.offset + chunkOffsets[i], librevenge::RVNG_SEEK_SET);
-    ParagraphStyle style = getParagraphStyle(input);
-    ret.push_back(TextParagraphReference(currentSpanBegin, textOffsets[i], style));
+    const auto inserted = stylesByChunkOffset.insert(std::make_pair(chunkOffsets[i], unsigned(styles.size())));
+    if (inserted.second)
+    {
+      input->seek(chunk.offset + chunkOffsets[i], librevenge::RVNG_SEEK_SET);
+      styles.push_back(getParagraphStyle(input));
+    }
+    ret.push_back(TextParagraphReference(currentSpanBegin, textOffsets[i], inserted.first->second));
     currentSpanBegin = textOffsets[i] + 1;
   }
   return ret;
 }
 
-std::vector<MSPUBParser::TextSpanReference> MSPUBParser::parseCharacterStyles(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk)
+std::vector<MSPUBParser::TextSpanReference> MSPUBParser::parseCharacterStyles(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk,
+                                                                           std::vector<CharacterStyle> &styles)
 {
   unsigned short numEntries = readU16(input);
   input->seek(input->tell() + 6, librevenge::RVNG_SEEK_SET);
@@ -1260,13 +1499,19 @@ std::vector<MSPUBParser::TextSpanReference> MSPUBParser::parseCharacterStyles(li
   {
     chunkOffsets.push_back(readU16(input));
   }
+  // many entries usually share the same style record
+  std::map<unsigned short, unsigned> stylesByChunkOffset;
   unsigned currentSpanBegin = 0;
   for (unsigned short i = 0; i < numEntries; ++i)
   {
-    input->seek(chunk.offset + chunkOffsets[i], librevenge::RVNG_SEEK_SET);
-    CharacterStyle style = getCharacterStyle(input);
+    const auto inserted = stylesByChunkOffset.insert(std::make_pair(chunkOffsets[i], unsigned(styles.size())));
+    if (inserted.second)
+    {
+      input->seek(chunk.offset + chunkOffsets[i], librevenge::RVNG_SEEK_SET);
+      styles.push_back(getCharacterStyle(input));
+    }
     currentSpanBegin = textOffsets[i] + 1;
-    ret.push_back(TextSpanReference(currentSpanBegin, textOffsets[i], style));
+    ret.push_back(TextSpanReference(currentSpanBegin, textOffsets[i], inserted.first->second));
   }
   return ret;
 }
@@ -1489,7 +1734,7 @@ CharacterStyle MSPUBParser::getCharacterStyle(librevenge::RVNGInputStream *input
   (void) seenItalic2;
   (void) seenBold2;
   style.textSizeInPt = dTextSize;
-  style.colorIndex = getColorIndexByQuillEntry(colorIndex);
+  style.colorIndex = colorIndex; // mapped by getColorIndexByQuillEntry() when the style is used
   style.fontIndex = fontIndex;
 
   return style;
@@ -1536,18 +1781,15 @@ int MSPUBParser::getColorIndex(librevenge::RVNGInputStream *input, const MSPUBBl
 bool MSPUBParser::parseEscher(librevenge::RVNGInputStream *input)
 {
   MSPUB_DEBUG_MSG(("MSPUBParser::parseEscher\n"));
-  EscherContainerInfo fakeroot;
-  fakeroot.initial = 0;
-  fakeroot.type = 0;
-  fakeroot.contentsOffset = input->tell();
-  fakeroot.contentsLength = (unsigned long)-1; //FIXME: Get the actual length
-  EscherContainerInfo dg, dgg;
+  indexEscherRecords(input);
   //Note: this assumes that dgg comes before any dg with images.
-  if (findEscherContainer(input, fakeroot, dgg, OFFICE_ART_DGG_CONTAINER))
+  const unsigned dgg = findEscherRecord(ESCHER_ROOT_RECORD, OFFICE_ART_DGG_CONTAINER);
+  if (dgg != NO_ESCHER_RECORD)
   {
     EscherContainerInfo bsc;
-    if (findEscherContainer(input, fakeroot, bsc, OFFICE_ART_B_STORE_CONTAINER))
+    if (findEscherContainer(dgg, bsc, OFFICE_ART_B_STORE_CONTAINER))
     {
+      input->seek(bsc.contentsOffset, librevenge::RVNG_SEEK_SET);
       unsigned short currentDelayIndex = 1;
       while (stillReading(input, bsc.contentsOffset + bsc.contentsLength))
       {
@@ -1564,30 +1806,28 @@ bool MSPUBParser::parseEscher(librevenge::RVNGInputStream *input)
         input->seek(begin + 44, librevenge::RVNG_SEEK_SET);
       }
     }
-    input->seek(dgg.contentsOffset + dgg.contentsLength + getEscherElementTailLength(OFFICE_ART_DGG_CONTAINER), librevenge::RVNG_SEEK_SET);
   }
-  while (findEscherContainer(input, fakeroot, dg, OFFICE_ART_DG_CONTAINER))
+  for (unsigned dg = findEscherRecord(ESCHER_ROOT_RECORD, OFFICE_ART_DG_CONTAINER, dgg);
+       dg != NO_ESCHER_RECORD;
+       dg = findEscherRecord(ESCHER_ROOT_RECORD, OFFICE_ART_DG_CONTAINER, dg))
   {
-    EscherContainerInfo spgr;
-    while (findEscherContainer(input, dg, spgr, OFFICE_ART_SPGR_CONTAINER))
+    for (unsigned spgr = findEscherRecord(dg, OFFICE_ART_SPGR_CONTAINER);
+         spgr != NO_ESCHER_RECORD;
+         spgr = findEscherRecord(dg, OFFICE_ART_SPGR_CONTAINER, spgr))
     {
       Coordinate c1, c2;
       parseShapeGroup(input, spgr, c1, c2);
     }
-    input->seek(input->tell() + getEscherElementTailLength(OFFICE_ART_DG_CONTAINER), librevenge::RVNG_SEEK_SET);
   }
   return true;
 }
 
-void MSPUBParser::parseShapeGroup(librevenge::RVNGInputStream *input, const EscherContainerInfo &spgr, Coordinate parentCoordinateSystem, Coordinate parentGroupAbsoluteCoord)
+void MSPUBParser::parseShapeGroup(librevenge::RVNGInputStream *input, unsigned spgr, Coordinate parentCoordinateSystem, Coordinate parentGroupAbsoluteCoord)
 {
-  EscherContainerInfo shapeOrGroup;
-  std::set<unsigned short> types;
-  types.insert(OFFICE_ART_SPGR_CONTAINER);
-  types.insert(OFFICE_ART_SP_CONTAINER);
-  while (findEscherContainerWithTypeInSet(input, spgr, shapeOrGroup, types))
+  for (unsigned shapeOrGroup = m_escherRecords[spgr].firstChild; shapeOrGroup != NO_ESCHER_RECORD;
+       shapeOrGroup = m_escherRecords[shapeOrGroup].nextSibling)
   {
-    switch (shapeOrGroup.type)
+    switch (m_escherRecords[shapeOrGroup].info.type)
     {
     case OFFICE_ART_SPGR_CONTAINER:
       m_collector->beginGroup();
@@ -1598,11 +1838,10 @@ void MSPUBParser::parseShapeGroup(librevenge::RVNGInputStream *input, const Esch
       parseEscherShape(input, shapeOrGroup, parentCoordinateSystem, parentGroupAbsoluteCoord);
       break;
     }
-    input->seek(shapeOrGroup.contentsOffset + shapeOrGroup.contentsLength + getEscherElementTailLength(shapeOrGroup.type), librevenge::RVNG_SEEK_SET);
   }
 }
 
-void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const EscherContainerInfo &sp, Coordinate &parentCoordinateSystem, Coordinate &parentGroupAbsoluteCoord)
+void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, unsigned sp, Coordinate &parentCoordinateSystem, Coordinate &parentGroupAbsoluteCoord)
 {
   Coordinate thisParentCoordinateSystem = parentCoordinateSystem;
   bool definesRelativeCoordinates = false;
@@ -1615,7 +1854,7 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
   unsigned shapeFlags = 0;
   bool isGroupLeader = false;
   ShapeType st = RECTANGLE;
-  if (findEscherContainer(input, sp, cFspgr, OFFICE_ART_FSPGR))
+  if (findEscherContainer(sp, cFspgr, OFFICE_ART_FSPGR))
   {
     input->seek(cFspgr.contentsOffset, librevenge::RVNG_SEEK_SET);
     parentCoordinateSystem.m_xs = readU32(input);
@@ -1625,25 +1864,22 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
     parentCoordinateSystem.arrange();
     definesRelativeCoordinates = true;
   }
-  input->seek(sp.contentsOffset, librevenge::RVNG_SEEK_SET);
-  if (findEscherContainer(input, sp, cFsp, OFFICE_ART_FSP))
+  if (findEscherContainer(sp, cFsp, OFFICE_ART_FSP))
   {
     st = (ShapeType)(cFsp.initial >> 4);
-    std::map<unsigned short, unsigned> fspData = extractEscherValues(input, cFsp);
+    EscherValues fspData = extractEscherValues(input, cFsp);
     input->seek(cFsp.contentsOffset + 4, librevenge::RVNG_SEEK_SET);
     shapeFlags = readU32(input);
     isGroupLeader = shapeFlags & SF_GROUP;
   }
-  input->seek(sp.contentsOffset, librevenge::RVNG_SEEK_SET);
-  if (findEscherContainer(input, sp, cData, OFFICE_ART_CLIENT_DATA))
+  if (findEscherContainer(sp, cData, OFFICE_ART_CLIENT_DATA))
   {
-    std::map<unsigned short, unsigned> dataValues = extractEscherValues(input, cData);
+    EscherValues dataValues = extractEscherValues(input, cData);
     unsigned *shapeSeqNum = getIfExists(dataValues, FIELDID_SHAPE_ID);
     if (shapeSeqNum)
     {
       m_collector->setShapeType(*shapeSeqNum, st);
       m_collector->setShapeFlip(*shapeSeqNum, shapeFlags & SF_FLIP_V, shapeFlags & SF_FLIP_H);
-      input->seek(sp.contentsOffset, librevenge::RVNG_SEEK_SET);
       if (isGroupLeader)
       {
         m_collector->setCurrentGroupSeqNum(*shapeSeqNum);
@@ -1656,19 +1892,18 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
       anchorTypes.insert(OFFICE_ART_CLIENT_ANCHOR);
       anchorTypes.insert(OFFICE_ART_CHILD_ANCHOR);
       bool foundAnchor;
-      if ((foundAnchor = findEscherContainerWithTypeInSet(input, sp, cAnchor, anchorTypes)) || isGroupLeader)
+      if ((foundAnchor = findEscherContainerWithTypeInSet(sp, cAnchor, anchorTypes)) || isGroupLeader)
       {
         bool rotated90 = false;
         MSPUB_DEBUG_MSG(("Found Escher data for %s of seqnum 0x%x\n", isGroupLeader ? "group" : "shape", *shapeSeqNum));
-        boost::optional<std::map<unsigned short, unsigned> > maybe_tertiaryFoptValues;
-        input->seek(sp.contentsOffset, librevenge::RVNG_SEEK_SET);
-        if (findEscherContainer(input, sp, cTertiaryFopt, OFFICE_ART_TERTIARY_FOPT))
+        boost::optional<EscherValues> maybe_tertiaryFoptValues;
+        if (findEscherContainer(sp, cTertiaryFopt, OFFICE_ART_TERTIARY_FOPT))
         {
           maybe_tertiaryFoptValues = extractEscherValues(input, cTertiaryFopt);
         }
         if (bool(maybe_tertiaryFoptValues))
         {
-          const std::map<unsigned short, unsigned> &tertiaryFoptValues =
+          const EscherValues &tertiaryFoptValues =
             maybe_tertiaryFoptValues.get();
           const unsigned *ptr_pictureRecolor = getIfExists_const(tertiaryFoptValues,
                                                                  FIELDID_PICTURE_RECOLOR);
@@ -1678,8 +1913,7 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
                                                 ColorReference(*ptr_pictureRecolor));
           }
         }
-        input->seek(sp.contentsOffset, librevenge::RVNG_SEEK_SET);
-        if (findEscherContainer(input, sp, cFopt, OFFICE_ART_FOPT))
+        if (findEscherContainer(sp, cFopt, OFFICE_ART_FOPT))
         {
           FOPTValues foptValues = extractFOPTValues(input, cFopt);
           unsigned *pxId = getIfExists(foptValues.m_scalarValues, FIELDID_PXID);
@@ -1720,7 +1954,7 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
           bool useLine = lineExistsByFlagPointer(
                            ptr_lineFlags, ptr_geomFlags);
           bool skipIfNotBg = false;
-          std::shared_ptr<Fill> ptr_fill = getNewFill(foptValues.m_scalarValues, skipIfNotBg, foptValues.m_complexValues);
+          std::shared_ptr<Fill> ptr_fill = getNewFill(foptValues, skipIfNotBg);
           unsigned lineWidth = 0;
           if (useLine)
           {
@@ -1734,7 +1968,7 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
             {
               if (bool(maybe_tertiaryFoptValues))
               {
-                std::map<unsigned short, unsigned> &tertiaryFoptValues =
+                EscherValues &tertiaryFoptValues =
                   maybe_tertiaryFoptValues.get();
                 unsigned *ptr_tertiaryLineFlags = getIfExists(tertiaryFoptValues, FIELDID_LINE_STYLE_BOOL_PROPS);
                 if (lineExistsByFlagPointer(ptr_tertiaryLineFlags))
@@ -1851,7 +2085,7 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
 
           if (bool(maybe_tertiaryFoptValues))
           {
-            std::map<unsigned short, unsigned> &tertiaryFoptValues = maybe_tertiaryFoptValues.get();
+            EscherValues &tertiaryFoptValues = maybe_tertiaryFoptValues.get();
             unsigned *ptr_numColumns = getIfExists(tertiaryFoptValues, FIELDID_NUM_COLUMNS);
             if (ptr_numColumns)
             {
@@ -1922,20 +2156,20 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
             }
           }
 
-          const std::vector<unsigned char> vertexData = foptValues.m_complexValues[FIELDID_P_VERTICES];
+          const ByteSpan vertexData = foptValues.getComplexValue(FIELDID_P_VERTICES);
           if (!vertexData.empty())
           {
             unsigned *p_geoRight = getIfExists(foptValues.m_scalarValues,
                                                FIELDID_GEO_RIGHT);
             unsigned *p_geoBottom = getIfExists(foptValues.m_scalarValues,
                                                 FIELDID_GEO_BOTTOM);
-            const std::vector<unsigned char> segmentData = foptValues.m_complexValues[FIELDID_P_SEGMENTS];
-            const std::vector<unsigned char> guideData = foptValues.m_complexValues[FIELDID_P_GUIDES];
+            const ByteSpan segmentData = foptValues.getComplexValue(FIELDID_P_SEGMENTS);
+            const ByteSpan guideData = foptValues.getComplexValue(FIELDID_P_GUIDES);
             m_collector->setShapeCustomPath(*shapeSeqNum, getDynamicCustomShape(vertexData, segmentData,
                                                                                 guideData, p_geoRight ? *p_geoRight : 21600,
                                                                                 p_geoBottom ? *p_geoBottom : 21600));
           }
-          const std::vector<unsigned char> wrapVertexData = foptValues.m_complexValues[FIELDID_P_WRAPPOLYGONVERTICES];
+          const ByteSpan wrapVertexData = foptValues.getComplexValue(FIELDID_P_WRAPPOLYGONVERTICES);
           if (!wrapVertexData.empty())
           {
             std::vector<Vertex> ret = parseVertices(wrapVertexData);
@@ -1947,10 +2181,10 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
           Coordinate absolute;
           if (cAnchor.type == OFFICE_ART_CLIENT_ANCHOR)
           {
-            std::map<unsigned short, unsigned> anchorData = extractEscherValues(input, cAnchor);
-            absolute = Coordinate(anchorData[FIELDID_XS],
-                                  anchorData[FIELDID_YS], anchorData[FIELDID_XE],
-                                  anchorData[FIELDID_YE]);
+            const EscherValues anchorData = extractEscherValues(input, cAnchor);
+            absolute = Coordinate(anchorData.get(FIELDID_XS),
+                                  anchorData.get(FIELDID_YS), anchorData.get(FIELDID_XE),
+                                  anchorData.get(FIELDID_YE));
           }
           else if (cAnchor.type == OFFICE_ART_CHILD_ANCHOR)
           {
@@ -1999,9 +2233,9 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
   }
 }
 
-std::shared_ptr<Fill> MSPUBParser::getNewFill(const std::map<unsigned short, unsigned> &foptProperties,
-                                              bool &skipIfNotBg, std::map<unsigned short, std::vector<unsigned char> > &foptValues)
+std::shared_ptr<Fill> MSPUBParser::getNewFill(const FOPTValues &foptValues, bool &skipIfNotBg)
 {
+  const EscherValues &foptProperties = foptValues.m_scalarValues;
   const FillType *ptr_fillType = (FillType *)getIfExists_const(foptProperties, FIELDID_FILL_TYPE);
   FillType fillType = ptr_fillType ? *ptr_fillType : SOLID;
   switch (fillType)
@@ -2074,7 +2308,7 @@ std::shared_ptr<Fill> MSPUBParser::getNewFill(const std::map<unsigned short, uns
     const unsigned *ptr_fillGrad = getIfExists_const(foptProperties, FIELDID_FILL_SHADE_COMPLEX);
     if (ptr_fillGrad)
     {
-      const std::vector<unsigned char> gradientData = foptValues[FIELDID_FILL_SHADE_COMPLEX];
+      const ByteSpan gradientData = foptValues.getComplexValue(FIELDID_FILL_SHADE_COMPLEX);
       if (gradientData.size() > 6)
       {
         unsigned short numEntries = gradientData[0] | (gradientData[1] << 8);
@@ -2170,8 +2404,8 @@ std::shared_ptr<Fill> MSPUBParser::getNewFill(const std::map<unsigned short, uns
 }
 
 DynamicCustomShape MSPUBParser::getDynamicCustomShape(
-  const std::vector<unsigned char> &vertexData, const std::vector<unsigned char> &segmentData,
-  const std::vector<unsigned char> &guideData, unsigned geoWidth,
+  const ByteSpan &vertexData, const ByteSpan &segmentData,
+  const ByteSpan &guideData, unsigned geoWidth,
   unsigned geoHeight)
 {
   DynamicCustomShape ret(geoWidth, geoHeight);
@@ -2182,7 +2416,7 @@ DynamicCustomShape MSPUBParser::getDynamicCustomShape(
 }
 
 std::vector<unsigned short> MSPUBParser::parseSegments(
-  const std::vector<unsigned char> &segmentData)
+  const ByteSpan &segmentData)
 {
   std::vector<unsigned short> ret;
   if (segmentData.size() < 6)
@@ -2205,7 +2439,7 @@ std::vector<unsigned short> MSPUBParser::parseSegments(
 }
 
 std::vector<Calculation> MSPUBParser::parseGuides(
-  const std::vector<unsigned char> &/* guideData */)
+  const ByteSpan &/* guideData */)
 {
   std::vector<Calculation> ret;
 
@@ -2215,7 +2449,7 @@ std::vector<Calculation> MSPUBParser::parseGuides(
 }
 
 std::vector<Vertex> MSPUBParser::parseVertices(
-  const std::vector<unsigned char> &vertexData)
+  const ByteSpan &vertexData)
 {
   std::vector<Vertex> ret;
   if (vertexData.size() < 6)
@@ -2282,6 +2516,21 @@ unsigned MSPUBParser::getEscherElementTailLength(unsigned short type)
   }
 }
 
+bool MSPUBParser::isEscherContainer(const EscherContainerInfo &info)
+{
+  switch (info.type)
+  {
+  case OFFICE_ART_DGG_CONTAINER:
+  case OFFICE_ART_B_STORE_CONTAINER:
+  case OFFICE_ART_DG_CONTAINER:
+  case OFFICE_ART_SPGR_CONTAINER:
+  case OFFICE_ART_SP_CONTAINER:
+    return true;
+  default:
+    return (info.initial & 0xF) == 0xF;
+  }
+}
+
 unsigned MSPUBParser::getEscherElementAdditionalHeaderLength(unsigned short type)
 {
   switch (type)
@@ -2293,43 +2542,97 @@ unsigned MSPUBParser::getEscherElementAdditionalHeaderLength(unsigned short type
   return 0;
 }
 
-bool MSPUBParser::findEscherContainerWithTypeInSet(librevenge::RVNGInputStream *input, const EscherContainerInfo &parent, EscherContainerInfo &out, std::set<unsigned short> types)
+void MSPUBParser::indexEscherRecords(librevenge::RVNGInputStream *input)
 {
-  while (stillReading(input, parent.contentsOffset + parent.contentsLength))
-  {
-    EscherContainerInfo next = parseEscherContainer(input);
-    if (types.find(next.type) != types.end())
-    {
-      out = next;
-      return true;
+  const unsigned long streamLength = getLength(input);
+  m_escherRecords.clear();
+  EscherRecord root;
+  root.info.initial = 0;
+  root.info.type = 0;
+  root.info.contentsOffset = input->tell();
+  root.info.contentsLength = streamLength - root.info.contentsOffset;
+  root.firstChild = NO_ESCHER_RECORD;
+  root.nextSibling = NO_ESCHER_RECORD;
+  m_escherRecords.push_back(root);
+
+  // containers to scan, with the offset their scan ends at
+  std::vector<std::pair<unsigned, unsigned long> > toVisit(1, std::make_pair(ESCHER_ROOT_RECORD, streamLength));
+  while (!toVisit.empty())
+  {
+    const unsigned parent = toVisit.back().first;
+    const unsigned long parentEnd = toVisit.back().second;
+    toVisit.pop_back();
+    unsigned previous = NO_ESCHER_RECORD;
+    input->seek(m_escherRecords[parent].info.contentsOffset, librevenge::RVNG_SEEK_SET);
+    while (stillReading(input, parentEnd))
+    {
+      if (streamLength - input->tell() < 8)
+      {
+        MSPUB_DEBUG_MSG(("Truncated escher record header at offset 0x%lx\n", input->tell()));
+        break;
+      }
+      EscherRecord record;
+      record.info = parseEscherContainer(input);
+      record.firstChild = NO_ESCHER_RECORD;
+      record.nextSibling = NO_ESCHER_RECORD;
+      const unsigned current = unsigned(m_escherRecords.size());
+      m_escherRecords.push_back(record);
+      if (previous == NO_ESCHER_RECORD)
+        m_escherRecords[parent].firstChild = current;
+      else
+        m_escherRecords[previous].nextSibling = current;
+      previous = current;
+      if (isEscherContainer(record.info))
+      {
+        // A container that runs past its parent is only scanned up to the
+        // parent's end, otherwise its trailing records would be indexed by
+        // both scans, doubling at each level of such nesting.
+        const unsigned long end = std::min(record.info.contentsOffset + record.info.contentsLength, parentEnd);
+        toVisit.push_back(std::make_pair(current, end));
+      }
+      input->seek(record.info.contentsOffset + record.info.contentsLength + getEscherElementTailLength(record.info.type), librevenge::RVNG_SEEK_SET);
     }
-    input->seek(next.contentsOffset + next.contentsLength + getEscherElementTailLength(next.type), librevenge::RVNG_SEEK_SET);
   }
-  return false;
 }
 
-bool MSPUBParser::findEscherContainer(librevenge::RVNGInputStream *input, const EscherContainerInfo &parent, EscherContainerInfo &out, unsigned short desiredType)
+unsigned MSPUBParser::findEscherRecord(unsigned parent, unsigned short type, unsigned after) const
 {
-  MSPUB_DEBUG_MSG(("At offset 0x%lx, attempting to find escher container of type 0x%x\n", input->tell(), desiredType));
-  while (stillReading(input, parent.contentsOffset + parent.contentsLength))
+  unsigned current = after == NO_ESCHER_RECORD ? m_escherRecords[parent].firstChild : m_escherRecords[after].nextSibling;
+  while (current != NO_ESCHER_RECORD && m_escherRecords[current].info.type != type)
+    current = m_escherRecords[current].nextSibling;
+  return current;
+}
+
+bool MSPUBParser::findEscherContainerWithTypeInSet(unsigned parent, EscherContainerInfo &out, const std::set<unsigned short> &types) const
+{
+  for (unsigned current = m_escherRecords[parent].firstChild; current != NO_ESCHER_RECORD; current = m_escherRecords[current].nextSibling)
   {
-    EscherContainerInfo next = parseEscherContainer(input);
-    if (next.type == desiredType)
+    if (types.find(m_escherRecords[current].info.type) != types.end())
     {
-      out = next;
+      out = m_escherRecords[current].info;
       return true;
     }
-    input->seek(next.contentsOffset + next.contentsLength + getEscherElementTailLength(next.type), librevenge::RVNG_SEEK_SET);
   }
   return false;
 }
 
+bool MSPUBParser::findEscherContainer(unsigned parent, EscherContainerInfo &out, unsigned short desiredType) const
+{
+  MSPUB_DEBUG_MSG(("Attempting to find escher container of type 0x%x in record %u\n", desiredType, parent));
+  const unsigned found = findEscherRecord(parent, desiredType);
+  if (found == NO_ESCHER_RECORD)
+    return false;
+  out = m_escherRecords[found].info;
+  return true;
+}
+
 FOPTValues MSPUBParser::extractFOPTValues(librevenge::RVNGInputStream *input, const EscherContainerInfo &record)
 {
   FOPTValues ret;
   input->seek(record.contentsOffset, librevenge::RVNG_SEEK_SET);
   unsigned short numValues = record.initial >> 4;
-  std::vector<unsigned short> complexIds;
+  ret.m_scalarValues.reserve(numValues);
+  boost::container::small_vector<unsigned short, 8> complexIds;
   for (unsigned short i = 0; i < numValues; ++i)
   {
     if (!stillReading(input, record.contentsOffset + record.contentsLength))
@@ -2338,20 +2641,23 @@ FOPTValues MSPUBParser::extractFOPTValues(librevenge::RVNGInputStream *input, co
     }
     unsigned short id = readU16(input);
     unsigned value  = readU32(input);
-    ret.m_scalarValues[id] = value;
+    ret.m_scalarValues.set(id, value);
     bool complex = id & 0x8000;
     if (complex)
     {
       complexIds.push_back(id);
     }
   }
+  // the complex data are collected into one buffer; the spans are only
+  // created once it can no longer be reallocated
+  PropertyBag<std::pair<unsigned long, unsigned long>, 4> complexRanges;
   for (unsigned short id : complexIds)
   {
     if (!stillReading(input, record.contentsOffset + record.contentsLength))
     {
       break;
     }
-    unsigned length = ret.m_scalarValues[id];
+    unsigned length = ret.m_scalarValues.get(id);
     if (!length)
     {
       continue;
@@ -2364,14 +2670,28 @@ FOPTValues MSPUBParser::extractFOPTValues(librevenge::RVNGInputStream *input, co
       entryLength = 4;
     }
     input->seek(-6, librevenge::RVNG_SEEK_CUR);
-    readNBytes(input, static_cast<unsigned long>(entryLength) * numEntries + 6, ret.m_complexValues[id]);
+    const unsigned long toRead = static_cast<unsigned long>(entryLength) * numEntries + 6;
+    unsigned long numBytesRead = 0;
+    const unsigned char *const data = input->read(toRead, numBytesRead);
+    if (numBytesRead != toRead)
+    {
+      complexRanges.set(id, std::make_pair(0ul, 0ul));
+      continue;
+    }
+    complexRanges.set(id, std::make_pair(static_cast<unsigned long>(ret.m_complexData.size()), numBytesRead));
+    ret.m_complexData.insert(ret.m_complexData.end(), data, data + numBytesRead);
+  }
+  for (const auto &range : complexRanges)
+  {
+    if (range.second.second != 0)
+      ret.m_complexValues.set(range.first, ByteSpan(ret.m_complexData.data() + range.second.first, range.second.second));
   }
   return ret;
 }
 
-std::map<unsigned short, unsigned> MSPUBParser::extractEscherValues(librevenge::RVNGInputStream *input, const EscherContainerInfo &record)
+EscherValues MSPUBParser::extractEscherValues(librevenge::RVNGInputStream *input, const EscherContainerInfo &record)
 {
-  std::map<unsigned short, unsigned> ret;
+  EscherValues ret;
   input->seek(record.contentsOffset + getEscherElementAdditionalHeaderLength(record.type), librevenge::RVNG_SEEK_SET);
   while (stillReading(input, record.contentsOffset + record.contentsLength))
   {
@@ -2383,7 +2703,7 @@ std::map<unsigned short, unsigned> MSPUBParser::extractEscherValues(librevenge::
       MSPUB_DEBUG_MSG(("found escher value with ID 0!\n"));
     }
     unsigned value = readU32(input);
-    ret[id] = value;
+    ret.set(id, value);
   }
   return ret;
 }
@@ -2449,7 +2769,7 @@ bool MSPUBParser::parseContentChunkReference(librevenge::RVNGInputStream *input,
     else if (type == CELLS)
     {
       m_contentChunks.push_back(ContentChunkReference(type, offset, 0, m_lastSeenSeqNum, seenParentSeqNum ? parentSeqNum : 0));
-      m_cellsChunkIndices.push_back(unsigned(m_contentChunks.size() - 1));
+      m_cellsChunkIndicesBySeqNum.insert(std::make_pair(m_contentChunks.back().seqNum, unsigned(m_contentChunks.size() - 1)));
       return true;
     }
     else if (type == PALETTE)
@@ -2489,6 +2809,19 @@ void MSPUBParser::skipBlock(librevenge::RVNGInputStream *input, MSPUBBlockInfo b
   input->seek(block.dataOffset + block.dataLength, librevenge::RVNG_SEEK_SET);
 }
 
+ByteSpan MSPUBParser::readBlockString(librevenge::RVNGInputStream *input, const MSPUBBlockInfo &block)
+{
+  if (block.dataLength <= 4)
+    return ByteSpan();
+  input->seek(block.dataOffset + 4, librevenge::RVNG_SEEK_SET);
+  const unsigned long length = block.dataLength - 4;
+  unsigned long numBytesRead = 0;
+  const unsigned char *const data = input->read(length, numBytesRead);
+  if (numBytesRead != length)
+    return ByteSpan();
+  return ByteSpan(data, numBytesRead);
+}
+
 EscherContainerInfo MSPUBParser::parseEscherContainer(librevenge::RVNGInputStream *input)
 {
   EscherContainerInfo info;
@@ -2514,8 +2847,11 @@ MSPUBBlockInfo MSPUBParser::parseBlock(librevenge::RVNGInputStream *input, bool
     info.dataLength = readU32(input);
     if (isBlockDataString(info.type))
     {
-      info.stringData = std::vector<unsigned char>();
-      readNBytes(input, info.dataLength - 4, info.stringData);
+      // the payload is read on demand by readBlockString()
+      if (info.dataLength < 4)
+        input->seek(0, librevenge::RVNG_SEEK_END);
+      else
+        skipBlock(input, info);
     }
     else if (skipHierarchicalData)
     {
@@ -2606,23 +2942,8 @@ void MSPUBParser::parsePaletteEntry(librevenge::RVNGInputStream *input, MSPUBBlo
 
 bool MSPUBParser::parseMetaData()
 {
-  m_input->seek(0, librevenge::RVNG_SEEK_SET);
   MSPUBMetaData metaData;
-
-  std::unique_ptr<librevenge::RVNGInputStream> sumaryInfo(m_input->getSubStreamByName("\x05SummaryInformation"));
-  if (sumaryInfo)
-  {
-    metaData.parse(sumaryInfo.get());
-  }
-
-  std::unique_ptr<librevenge::RVNGInputStream> docSumaryInfo(m_input->getSubStreamByName("\005DocumentSummaryInformation"));
-  if (docSumaryInfo)
-  {
-    metaData.parse(docSumaryInfo.get());
-  }
-
-  m_input->seek(0, librevenge::RVNG_SEEK_SET);
-  metaData.parseTimes(m_input);
+  metaData.parseStorage(m_input);
   m_collector->collectMetaData(metaData.getMetaData());
 
   return true;
@@ -22,6 +22,10 @@
 
 #include "MSPUBTypes.h"
 #include "PolygonUtils.h"
+#include "PropertyBag.h"
+#include "ShapeType.h"
+#include "TableInfo.h"
+#include "VerticalAlign.h"
 
 namespace libmspub
 {
@@ -53,13 +57,30 @@ public:
   }
 };
 
+typedef PropertyBag<unsigned, 32> EscherValues;
+
+/** Property table of an Escher FOPT record.
+ *
+ * The complex values point into m_complexData, which is filled once
+ * per record; the struct is therefore movable but not copyable.
+ */
 struct FOPTValues
 {
-  std::map<unsigned short, unsigned> m_scalarValues;
-  std::map<unsigned short, std::vector<unsigned char> > m_complexValues;
-  FOPTValues() : m_scalarValues(), m_complexValues()
+  EscherValues m_scalarValues;
+  PropertyBag<ByteSpan, 4> m_complexValues;
+  std::vector<unsigned char> m_complexData;
+  FOPTValues() : m_scalarValues(), m_complexValues(), m_complexData()
   {
   }
+  FOPTValues(FOPTValues &&) = default;
+  FOPTValues &operator=(FOPTValues &&) = default;
+  FOPTValues(const FOPTValues &) = delete;
+  FOPTValues &operator=(const FOPTValues &) = delete;
+
+  ByteSpan getComplexValue(unsigned short id) const
+  {
+    return m_complexValues.get(id);
+  }
 };
 
 class MSPUBParser
@@ -68,23 +89,61 @@ public:
   explicit MSPUBParser(librevenge::RVNGInputStream *input, MSPUBCollector *collector);
   virtual ~MSPUBParser();
   virtual bool parse();
+  /// Sets the number of threads that independent chunks may be decoded on (1 by default).
+  void setThreadCount(unsigned count);
+  /// Sets whether independent streams are parsed on separate threads.
+  void setPipelined(bool pipelined);
 protected:
   virtual unsigned getColorIndexByQuillEntry(unsigned entry);
 
+  // The style ids index the styles of the Quill chunk the reference was
+  // read from, until parseQuill replaces them by the collector's style ids.
   struct TextSpanReference
   {
-    TextSpanReference(unsigned short f, unsigned short l, const CharacterStyle &cs) : first(f), last(l), charStyle(cs) { }
+    TextSpanReference(unsigned short f, unsigned short l, unsigned cs) : first(f), last(l), charStyleId(cs) { }
     unsigned short first;
     unsigned short last;
-    CharacterStyle charStyle;
+    unsigned charStyleId;
   };
 
   struct TextParagraphReference
   {
-    TextParagraphReference(unsigned short f, unsigned short l, const ParagraphStyle &ps) : first(f), last(l), paraStyle(ps) { }
+    TextParagraphReference(unsigned short f, unsigned short l, unsigned ps) : first(f), last(l), paraStyleId(ps) { }
     unsigned short first;
     unsigned short last;
-    ParagraphStyle paraStyle;
+    unsigned paraStyleId;
+  };
+
+  /// Decoded contents of a Quill formatting chunk, not yet added to the collector.
+  struct QuillChunkData
+  {
+    QuillChunkData()
+      : spans(), paras(), charStyles(), paraStyles(), defaultCharStyles(), defaultParaStyles(), fonts(), tableCellTextEnds()
+    {
+    }
+    std::vector<TextSpanReference> spans;
+    std::vector<TextParagraphReference> paras;
+    std::vector<CharacterStyle> charStyles;
+    std::vector<ParagraphStyle> paraStyles;
+    std::vector<CharacterStyle> defaultCharStyles;
+    std::vector<ParagraphStyle> defaultParaStyles;
+    std::vector<std::vector<unsigned char> > fonts;
+    std::vector<unsigned> tableCellTextEnds;
+  };
+
+  /// Properties of a shape read from its Contents chunk, not yet added to the collector.
+  struct ShapeChunkData
+  {
+    ShapeChunkData()
+      : tableInfo(), textId(), borderImageId(), verticalAlign(), cropType(), stretchBorderArt(false)
+    {
+    }
+    boost::optional<TableInfo> tableInfo;
+    boost::optional<unsigned> textId;
+    boost::optional<unsigned> borderImageId;
+    boost::optional<VerticalAlign> verticalAlign;
+    boost::optional<ShapeType> cropType;
+    bool stretchBorderArt;
   };
 
   typedef std::vector<ContentChunkReference>::const_iterator ccr_iterator_t;
@@ -94,9 +153,11 @@ protected:
   MSPUBParser &operator=(const MSPUBParser &);
   virtual bool parseContents(librevenge::RVNGInputStream *input);
   bool parseMetaData();
+  bool parsePipelined(const std::vector<unsigned char> &quillData);
+  bool parseDocumentStreams();
   bool parseQuill(librevenge::RVNGInputStream *input);
   bool parseEscher(librevenge::RVNGInputStream *input);
-  bool parseEscherDelay(librevenge::RVNGInputStream *input);
+  bool parseEscherDelay(std::unique_ptr<librevenge::RVNGInputStream> input);
 
   MSPUBBlockInfo parseBlock(librevenge::RVNGInputStream *input, bool skipHierarchicalData = false);
   EscherContainerInfo parseEscherContainer(librevenge::RVNGInputStream *input);
@@ -107,67 +168,84 @@ protected:
   bool parsePageChunk(librevenge::RVNGInputStream *input, const ContentChunkReference &chunk);
   bool parsePaletteChunk(librevenge::RVNGInputStream *input, const ContentChunkReference &chunk);
   bool parsePageShapeList(librevenge::RVNGInputStream *input, MSPUBBlockInfo block, unsigned pageSeqNum);
-  bool parseShape(librevenge::RVNGInputStream *input, const ContentChunkReference &chunk);
+  void dropUnreachableShapeChunks();
+  bool parseShapeChunks(librevenge::RVNGInputStream *input);
+  bool decodeShapeChunk(librevenge::RVNGInputStream *input, const ContentChunkReference &chunk, ShapeChunkData &data);
+  void commitShapeChunk(const ContentChunkReference &chunk, const ShapeChunkData &data);
   bool parseBorderArtChunk(librevenge::RVNGInputStream *input,
                            const ContentChunkReference &chunk);
   bool parseFontChunk(librevenge::RVNGInputStream *input,
                       const ContentChunkReference &chunk);
   void parsePaletteEntry(librevenge::RVNGInputStream *input, MSPUBBlockInfo block);
   void parseColors(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk);
-  void parseFonts(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk);
-  void parseDefaultStyle(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk);
-  void parseShapeGroup(librevenge::RVNGInputStream *input, const EscherContainerInfo &spgr, Coordinate parentCoordinateSystem, Coordinate parentGroupAbsoluteCoord);
+  std::vector<std::vector<unsigned char> > parseFonts(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk);
+  void parseDefaultStyle(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk,
+                         std::vector<CharacterStyle> &charStyles, std::vector<ParagraphStyle> &paraStyles);
+  void decodeQuillChunk(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk, QuillChunkData &data);
+  void decodeQuillChunks(librevenge::RVNGInputStream *input, const std::vector<QuillChunkReference> &chunks,
+                         std::vector<QuillChunkData> &data);
+  void parseShapeGroup(librevenge::RVNGInputStream *input, unsigned spgr, Coordinate parentCoordinateSystem, Coordinate parentGroupAbsoluteCoord);
   void skipBlock(librevenge::RVNGInputStream *input, MSPUBBlockInfo block);
-  void parseEscherShape(librevenge::RVNGInputStream *input, const EscherContainerInfo &sp, Coordinate &parentCoordinateSystem, Coordinate &parentGroupAbsoluteCoord);
-  bool findEscherContainer(librevenge::RVNGInputStream *input, const EscherContainerInfo &parent, EscherContainerInfo &out, unsigned short type);
-  bool findEscherContainerWithTypeInSet(librevenge::RVNGInputStream *input, const EscherContainerInfo &parent, EscherContainerInfo &out, std::set<unsigned short> types);
-  std::map<unsigned short, unsigned> extractEscherValues(librevenge::RVNGInputStream *input, const EscherContainerInfo &record);
+  static ByteSpan readBlockString(librevenge::RVNGInputStream *input, const MSPUBBlockInfo &block);
+  void parseEscherShape(librevenge::RVNGInputStream *input, unsigned sp, Coordinate &parentCoordinateSystem, Coordinate &parentGroupAbsoluteCoord);
+  void indexEscherRecords(librevenge::RVNGInputStream *input);
+  unsigned findEscherRecord(unsigned parent, unsigned short type, unsigned after = NO_ESCHER_RECORD) const;
+  bool findEscherContainer(unsigned parent, EscherContainerInfo &out, unsigned short type) const;
+  bool findEscherContainerWithTypeInSet(unsigned parent, EscherContainerInfo &out, const std::set<unsigned short> &types) const;
+  EscherValues extractEscherValues(librevenge::RVNGInputStream *input, const EscherContainerInfo &record);
   FOPTValues extractFOPTValues(librevenge::RVNGInputStream *input,
                                const libmspub::EscherContainerInfo &record);
-  std::vector<TextSpanReference> parseCharacterStyles(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk);
-  std::vector<TextParagraphReference> parseParagraphStyles(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk);
-  std::vector<Calculation> parseGuides(const std::vector<unsigned char>
-                                       &guideData);
-  std::vector<Vertex> parseVertices(const std::vector<unsigned char>
-                                    &vertexData);
+  std::vector<TextSpanReference> parseCharacterStyles(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk,
+                                                      std::vector<CharacterStyle> &styles);
+  std::vector<TextParagraphReference> parseParagraphStyles(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk,
+                                                           std::vector<ParagraphStyle> &styles);
+  std::vector<Calculation> parseGuides(const ByteSpan &guideData);
+  std::vector<Vertex> parseVertices(const ByteSpan &vertexData);
   std::vector<unsigned> parseTableCellDefinitions(librevenge::RVNGInputStream *input,
                                                   const QuillChunkReference &chunk);
-  std::vector<unsigned short> parseSegments(
-    const std::vector<unsigned char> &segmentData);
+  std::vector<unsigned short> parseSegments(const ByteSpan &segmentData);
   DynamicCustomShape getDynamicCustomShape(
-    const std::vector<unsigned char> &vertexData,
-    const std::vector<unsigned char> &segmentData,
-    const std::vector<unsigned char> &guideData,
+    const ByteSpan &vertexData, const ByteSpan &segmentData,
+    const ByteSpan &guideData,
     unsigned geoWidth, unsigned geoHeight);
   int getColorIndex(librevenge::RVNGInputStream *input, const MSPUBBlockInfo &info);
   unsigned getFontIndex(librevenge::RVNGInputStream *input, const MSPUBBlockInfo &info);
   CharacterStyle getCharacterStyle(librevenge::RVNGInputStream *input);
   ParagraphStyle getParagraphStyle(librevenge::RVNGInputStream *input);
-  std::shared_ptr<Fill> getNewFill(const std::map<unsigned short, unsigned> &foptProperties, bool &skipIfNotBg, std::map<unsigned short, std::vector<unsigned char> > &foptValues);
+  std::shared_ptr<Fill> getNewFill(const FOPTValues &foptValues, bool &skipIfNotBg);
 
   librevenge::RVNGInputStream *m_input;
   unsigned m_length;
   MSPUBCollector *m_collector;
   std::vector<MSPUBBlockInfo> m_blockInfo;
   std::vector<ContentChunkReference> m_contentChunks;
-  std::vector<unsigned> m_cellsChunkIndices;
+  std::map<unsigned, unsigned> m_cellsChunkIndicesBySeqNum;
   std::vector<unsigned> m_pageChunkIndices;
   std::vector<unsigned> m_shapeChunkIndices;
   std::vector<unsigned> m_paletteChunkIndices;
   std::vector<unsigned> m_borderArtChunkIndices;
   std::vector<unsigned> m_fontChunkIndices;
   std::vector<unsigned> m_unknownChunkIndices;
+  // the shapes that the pages other than the dummy pages list
+  std::set<unsigned> m_listedShapeSeqNums;
   boost::optional<unsigned> m_documentChunkIndex;
   int m_lastSeenSeqNum;
   unsigned m_lastAddedImage;
   std::vector<int> m_alternateShapeSeqNums;
   std::vector<int> m_escherDelayIndices;
+  std::vector<EscherRecord> m_escherRecords;
+  unsigned m_threadCount;
+  bool m_pipelined;
+
+  static const unsigned ESCHER_ROOT_RECORD = 0;
+  static const unsigned NO_ESCHER_RECORD = unsigned(-1);
 
   static short getBlockDataLength(unsigned type);
   static bool isBlockDataString(unsigned type);
   static PageType getPageTypeBySeqNum(unsigned seqNum);
   static unsigned getEscherElementTailLength(unsigned short type);
   static unsigned getEscherElementAdditionalHeaderLength(unsigned short type);
+  static bool isEscherContainer(const EscherContainerInfo &info);
   static ImgType imgTypeByBlipType(unsigned short type);
   static int getStartOffset(ImgType type, unsigned short initial);
   static bool lineExistsByFlagPointer(unsigned *flags,
@@ -31,19 +31,21 @@ namespace
 class ChunkNestingGuard
 {
 public:
-  ChunkNestingGuard(std::deque<unsigned> &chunks, const unsigned seqNum)
+  ChunkNestingGuard(std::set<unsigned> &chunks, const unsigned seqNum)
     : m_chunks(chunks)
+    , m_seqNum(seqNum)
   {
-    m_chunks.push_front(seqNum);
+    m_chunks.insert(m_seqNum);
   }
 
   ~ChunkNestingGuard()
   {
-    m_chunks.pop_front();
+    m_chunks.erase(m_seqNum);
   }
 
 private:
-  std::deque<unsigned> &m_chunks;
+  std::set<unsigned> &m_chunks;
+  const unsigned m_seqNum;
 };
 
 }
@@ -51,8 +53,11 @@ private:
 MSPUBParser2k::MSPUBParser2k(librevenge::RVNGInputStream *input, MSPUBCollector *collector)
   : MSPUBParser(input, collector),
     m_imageDataChunkIndices(),
+    m_imageDataIndicesByParentSeqNum(),
     m_quillColorEntries(),
+    m_quillColorIndicesByEntry(),
     m_chunkChildIndicesById(),
+    m_pageChunkIndicesBySeqNum(),
     m_chunksBeingRead()
 {
 }
@@ -60,14 +65,15 @@ MSPUBParser2k::MSPUBParser2k(librevenge::RVNGInputStream *input, MSPUBCollector
 unsigned MSPUBParser2k::getColorIndexByQuillEntry(unsigned entry)
 {
   unsigned translation = translate2kColorReference(entry);
-  std::vector<unsigned>::const_iterator i_entry = std::find(m_quillColorEntries.begin(), m_quillColorEntries.end(), translation);
-  if (i_entry == m_quillColorEntries.end())
+  const unsigned *ptr_index = getIfExists_const(m_quillColorIndicesByEntry, translation);
+  if (!ptr_index)
   {
     m_quillColorEntries.push_back(translation);
+    m_quillColorIndicesByEntry[translation] = unsigned(m_quillColorEntries.size() - 1);
     m_collector->addTextColor(ColorReference(translation));
     return m_quillColorEntries.size() - 1;
   }
-  return i_entry - m_quillColorEntries.begin();
+  return *ptr_index;
 }
 
 MSPUBParser2k::~MSPUBParser2k()
@@ -372,6 +378,8 @@ bool MSPUBParser2k::parseContents(librevenge::RVNGInputStream *input)
       MSPUB_DEBUG_MSG(("Found page chunk of id 0x%x and parent 0x%x\n", id, parent));
       m_contentChunks.push_back(ContentChunkReference(PAGE, chunkOffset, 0, id, parent));
       m_pageChunkIndices.push_back(unsigned(m_contentChunks.size() - 1));
+      // the first page chunk with a given id wins, as with the linear lookup this replaces
+      m_pageChunkIndicesBySeqNum.insert(std::make_pair(id, unsigned(m_contentChunks.size() - 1)));
       m_chunkChildIndicesById[parent].push_back(unsigned(m_contentChunks.size() - 1));
       break;
     case 0x0015:
@@ -389,6 +397,7 @@ bool MSPUBParser2k::parseContents(librevenge::RVNGInputStream *input)
     case 0x0021:
       MSPUB_DEBUG_MSG(("Found image_2k_data chunk of id 0x%x and parent 0x%x\n", id, parent));
       m_contentChunks.push_back(ContentChunkReference(IMAGE_2K_DATA, chunkOffset, 0, id, parent));
+      m_imageDataIndicesByParentSeqNum.insert(std::make_pair(parent, unsigned(m_imageDataChunkIndices.size())));
       m_imageDataChunkIndices.push_back(unsigned(m_contentChunks.size() - 1));
       m_chunkChildIndicesById[parent].push_back(unsigned(m_contentChunks.size() - 1));
       break;
@@ -452,15 +461,9 @@ bool MSPUBParser2k::parseContents(librevenge::RVNGInputStream *input)
   {
     const ContentChunkReference &chunk = m_contentChunks.at(imageDataChunkIndex);
     input->seek(chunk.offset + 4, librevenge::RVNG_SEEK_SET);
-    unsigned toRead = readU32(input);
+    const unsigned length = readU32(input);
     librevenge::RVNGBinaryData img;
-    while (toRead > 0 && stillReading(input, (unsigned long)-1))
-    {
-      unsigned long howManyRead = 0;
-      const unsigned char *buf = input->read(toRead, howManyRead);
-      img.append(buf, howManyRead);
-      toRead -= howManyRead;
-    }
+    readBinaryData(input, length, img);
     m_collector->addImage(++m_lastAddedImage, WMF, img);
   }
 
@@ -506,7 +509,7 @@ void MSPUBParser2k::parseShapeRotation(librevenge::RVNGInputStream *input, bool
 bool MSPUBParser2k::parse2kShapeChunk(const ContentChunkReference &chunk, librevenge::RVNGInputStream *input,
                                       boost::optional<unsigned> pageSeqNum, bool topLevelCall)
 {
-  if (find(m_chunksBeingRead.begin(), m_chunksBeingRead.end(), chunk.seqNum) != m_chunksBeingRead.end())
+  if (m_chunksBeingRead.find(chunk.seqNum) != m_chunksBeingRead.end())
   {
     MSPUB_DEBUG_MSG(("chunk %u is nested in itself", chunk.seqNum));
     return false;
@@ -518,20 +521,12 @@ bool MSPUBParser2k::parse2kShapeChunk(const ContentChunkReference &chunk, librev
   if (topLevelCall)
   {
     // ignore non top level shapes
-    int i_page = -1;
-    for (unsigned int pageIndex : m_pageChunkIndices)
-    {
-      if (m_contentChunks.at(pageIndex).seqNum == chunk.parentSeqNum)
-      {
-        i_page = pageIndex;
-        break;
-      }
-    }
-    if (i_page == -1)
+    const unsigned *ptr_pageIndex = getIfExists_const(m_pageChunkIndicesBySeqNum, chunk.parentSeqNum);
+    if (!ptr_pageIndex)
     {
       return false;
     }
-    if (getPageTypeBySeqNum(m_contentChunks[i_page].seqNum) != NORMAL)
+    if (getPageTypeBySeqNum(m_contentChunks.at(*ptr_pageIndex).seqNum) != NORMAL)
     {
       return false;
     }
@@ -616,18 +611,10 @@ bool MSPUBParser2k::parseGroup(librevenge::RVNGInputStream *input, unsigned seqN
 
 void MSPUBParser2k::assignShapeImgIndex(unsigned seqNum)
 {
-  int i_dataIndex = -1;
-  for (size_t j = 0; j < m_imageDataChunkIndices.size(); ++j)
-  {
-    if (m_contentChunks.at(m_imageDataChunkIndices[j]).parentSeqNum == seqNum)
-    {
-      i_dataIndex = j;
-      break;
-    }
-  }
-  if (i_dataIndex >= 0)
+  const unsigned *ptr_dataIndex = getIfExists_const(m_imageDataIndicesByParentSeqNum, seqNum);
+  if (ptr_dataIndex)
   {
-    m_collector->setShapeImgIndex(seqNum, i_dataIndex + 1);
+    m_collector->setShapeImgIndex(seqNum, *ptr_dataIndex + 1);
   }
 }
 
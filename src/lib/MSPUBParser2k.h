@@ -10,9 +10,9 @@
 #ifndef INCLUDED_MSPUBPARSER2K_H
 #define INCLUDED_MSPUBPARSER2K_H
 
-#include <deque>
-#include <vector>
 #include <map>
+#include <set>
+#include <vector>
 
 #include "MSPUBParser.h"
 #include "ShapeType.h"
@@ -24,9 +24,12 @@ class MSPUBParser2k : public MSPUBParser
 {
   static ShapeType getShapeType(unsigned char shapeSpecifier);
   std::vector<unsigned> m_imageDataChunkIndices;
+  std::map<unsigned, unsigned> m_imageDataIndicesByParentSeqNum;
   std::vector<unsigned> m_quillColorEntries;
+  std::map<unsigned, unsigned> m_quillColorIndicesByEntry;
   std::map<unsigned, std::vector<unsigned> > m_chunkChildIndicesById;
-  std::deque<unsigned> m_chunksBeingRead;
+  std::map<unsigned, unsigned> m_pageChunkIndicesBySeqNum;
+  std::set<unsigned> m_chunksBeingRead;
 
 protected:
   // helper functions
@@ -87,10 +87,14 @@ void MSPUBParser97::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
   unsigned iParaEnd = 0, iSpanEnd = 0;
   unsigned currentParaIndex = 0;
   unsigned currentSpanIndex = 0;
+  const unsigned paraStyleId = m_collector->addParagraphStyle(ParagraphStyle());
   for (size_t iShapeEnd = 0; iShapeEnd < textInfo.m_shapeEnds.size(); ++iShapeEnd)
   {
     unsigned shapeEnd = std::min<unsigned>(textInfo.m_shapeEnds[iShapeEnd], textInfo.m_chars.size());
     std::vector<TextParagraph> shapeParas;
+    // the text of all spans of the shape, one after another
+    std::vector<unsigned char> shapeChars;
+    shapeChars.reserve(shapeEnd > currentParaIndex ? shapeEnd - currentParaIndex : 0);
     while (currentParaIndex < shapeEnd)
     {
       unsigned paraEnd = iParaEnd < textInfo.m_paragraphEnds.size() ?
@@ -113,14 +117,13 @@ void MSPUBParser97::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
           spanEnd = paraEnd;
         }
         const CharacterStyle &spanStyle = spanInfo.m_style;
-        std::vector<unsigned char> spanChars;
-        spanChars.reserve(std::min(spanEnd - currentSpanIndex, m_length));
+        const std::size_t spanStart = shapeChars.size();
         for (unsigned i = currentSpanIndex; i < spanEnd; ++i)
         {
           unsigned char ch = textInfo.m_chars[i];
           if (ch == 0xB) // Pub97 interprets vertical tab as nonbreaking space.
           {
-            spanChars.push_back('\n');
+            shapeChars.push_back('\n');
           }
           else if (ch == 0x0D)
           {
@@ -135,15 +138,25 @@ void MSPUBParser97::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
           }
           else
           {
-            spanChars.push_back(ch);
+            shapeChars.push_back(ch);
           }
         }
-        paraSpans.push_back(TextSpan(spanChars, spanStyle));
+        paraSpans.push_back(TextSpan(ByteSpan(nullptr, shapeChars.size() - spanStart), m_collector->addCharacterStyle(spanStyle)));
         currentSpanIndex = spanEnd;
       }
-      shapeParas.push_back(TextParagraph(paraSpans, ParagraphStyle()));
+      shapeParas.push_back(TextParagraph(paraSpans, paraStyleId));
       currentParaIndex = paraEnd;
     }
+    // shapeChars is complete now, so it is safe to point the spans into it
+    std::size_t spanStart = 0;
+    for (auto &para : shapeParas)
+    {
+      for (auto &span : para.spans)
+      {
+        span.chars = ByteSpan(shapeChars.data() + spanStart, span.chars.size());
+        spanStart += span.chars.size();
+      }
+    }
     m_collector->addTextString(shapeParas, iShapeEnd);
   }
 }
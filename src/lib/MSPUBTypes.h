@@ -10,7 +10,9 @@
 #ifndef INCLUDED_MSPUBTYPES_H
 #define INCLUDED_MSPUBTYPES_H
 
+#include <cstddef>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <boost/optional.hpp>
@@ -75,16 +77,47 @@ struct EscherContainerInfo
   unsigned long contentsOffset;
 };
 
+struct EscherRecord
+{
+  EscherContainerInfo info;
+  unsigned firstChild;
+  unsigned nextSibling;
+};
+
+/** Non-owning view of a run of bytes. */
+struct ByteSpan
+{
+  ByteSpan() : m_data(nullptr), m_size(0) { }
+  ByteSpan(const unsigned char *data, std::size_t size) : m_data(data), m_size(size) { }
+  const unsigned char *data() const
+  {
+    return m_data;
+  }
+  std::size_t size() const
+  {
+    return m_size;
+  }
+  bool empty() const
+  {
+    return m_size == 0;
+  }
+  unsigned char operator[](std::size_t i) const
+  {
+    return m_data[i];
+  }
+  const unsigned char *m_data;
+  std::size_t m_size;
+};
+
 struct MSPUBBlockInfo
 {
-  MSPUBBlockInfo() : id(0), type(0), startPosition(0), dataOffset(0), dataLength(0), data(0), stringData() { }
+  MSPUBBlockInfo() : id(0), type(0), startPosition(0), dataOffset(0), dataLength(0), data(0) { }
   unsigned id;
   unsigned type;
   unsigned long startPosition;
   unsigned long dataOffset;
   unsigned long dataLength;
   unsigned data;
-  std::vector<unsigned char> stringData;
 };
 
 struct ContentChunkReference
@@ -101,10 +134,11 @@ struct ContentChunkReference
 
 struct QuillChunkReference
 {
-  QuillChunkReference() : length(0), offset(0), id(0), name(), name2() { }
+  QuillChunkReference() : length(0), offset(0), id(0), type(0), name(), name2() { }
   unsigned long length;
   unsigned long offset;
   unsigned short id;
+  unsigned type; // name packed by MSPUB_FOURCC, see QuillChunkType.h
   std::string name;
   std::string name2;
 };
@@ -141,6 +175,14 @@ struct CharacterStyle
   boost::optional<unsigned> lcid;
 };
 
+inline bool operator<(const CharacterStyle &lhs, const CharacterStyle &rhs)
+{
+  return std::tie(lhs.underline, lhs.italic, lhs.bold, lhs.textSizeInPt, lhs.colorIndex, lhs.fontIndex, lhs.superSubType,
+                  lhs.outline, lhs.shadow, lhs.smallCaps, lhs.allCaps, lhs.emboss, lhs.engrave, lhs.textScale, lhs.lcid)
+         < std::tie(rhs.underline, rhs.italic, rhs.bold, rhs.textSizeInPt, rhs.colorIndex, rhs.fontIndex, rhs.superSubType,
+                    rhs.outline, rhs.shadow, rhs.smallCaps, rhs.allCaps, rhs.emboss, rhs.engrave, rhs.textScale, rhs.lcid);
+}
+
 enum LineSpacingType
 {
   LINE_SPACING_SP,
@@ -160,6 +202,11 @@ struct LineSpacingInfo
   }
 };
 
+inline bool operator<(const LineSpacingInfo &lhs, const LineSpacingInfo &rhs)
+{
+  return std::tie(lhs.m_type, lhs.m_amount) < std::tie(rhs.m_type, rhs.m_amount);
+}
+
 struct ParagraphStyle
 {
   boost::optional<Alignment> m_align;
@@ -182,18 +229,55 @@ struct ParagraphStyle
   }
 };
 
+inline bool operator<(const ParagraphStyle &lhs, const ParagraphStyle &rhs)
+{
+  return std::tie(lhs.m_align, lhs.m_defaultCharStyleIndex, lhs.m_lineSpacing, lhs.m_spaceBeforeEmu, lhs.m_spaceAfterEmu,
+                  lhs.m_firstLineIndentEmu, lhs.m_leftIndentEmu, lhs.m_rightIndentEmu, lhs.m_listInfo, lhs.m_tabStopsInEmu,
+                  lhs.m_dropCapLines, lhs.m_dropCapLetters)
+         < std::tie(rhs.m_align, rhs.m_defaultCharStyleIndex, rhs.m_lineSpacing, rhs.m_spaceBeforeEmu, rhs.m_spaceAfterEmu,
+                    rhs.m_firstLineIndentEmu, rhs.m_leftIndentEmu, rhs.m_rightIndentEmu, rhs.m_listInfo, rhs.m_tabStopsInEmu,
+                    rhs.m_dropCapLines, rhs.m_dropCapLetters);
+}
+
 struct TextSpan
 {
-  TextSpan(const std::vector<unsigned char> &c, const CharacterStyle &s) : chars(c), style(s) { }
-  std::vector<unsigned char> chars;
-  CharacterStyle style;
+  TextSpan(const ByteSpan &c, unsigned s) : chars(c), styleId(s) { }
+  ByteSpan chars; // only has to stay valid until the text is passed to MSPUBCollector::addTextString
+  unsigned styleId; // see MSPUBCollector::addCharacterStyle
 };
 
 struct TextParagraph
 {
-  TextParagraph(const std::vector<TextSpan> &sp, const ParagraphStyle &st) : spans(sp), style(st) { }
+  TextParagraph(const std::vector<TextSpan> &sp, unsigned st) : spans(sp), styleId(st) { }
   std::vector<TextSpan> spans;
-  ParagraphStyle style;
+  unsigned styleId; // see MSPUBCollector::addParagraphStyle
+};
+
+// Stored text: the bytes of all spans are kept in one buffer, and the
+// records below say how it is divided.
+
+struct TextSpanRecord
+{
+  TextSpanRecord(unsigned offset, unsigned length, unsigned styleId) : m_offset(offset), m_length(length), m_styleId(styleId) { }
+  unsigned m_offset; // in the text buffer
+  unsigned m_length;
+  unsigned m_styleId;
+};
+
+struct TextParagraphRecord
+{
+  TextParagraphRecord(unsigned firstSpan, unsigned spanCount, unsigned styleId) : m_firstSpan(firstSpan), m_spanCount(spanCount), m_styleId(styleId) { }
+  unsigned m_firstSpan;
+  unsigned m_spanCount;
+  unsigned m_styleId;
+};
+
+struct TextStringRecord
+{
+  TextStringRecord() : m_firstParagraph(0), m_paragraphCount(0) { }
+  TextStringRecord(unsigned firstParagraph, unsigned paragraphCount) : m_firstParagraph(firstParagraph), m_paragraphCount(paragraphCount) { }
+  unsigned m_firstParagraph;
+  unsigned m_paragraphCount;
 };
 
 struct Color
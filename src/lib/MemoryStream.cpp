@@ -0,0 +1,112 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "MemoryStream.h"
+
+namespace libmspub
+{
+
+MemoryStream::MemoryStream(const unsigned char *const data, const unsigned long size)
+  : m_data(data)
+  , m_size(size)
+  , m_offset(0)
+{
+}
+
+MemoryStream::~MemoryStream()
+{
+}
+
+bool MemoryStream::isStructured()
+{
+  return false;
+}
+
+unsigned MemoryStream::subStreamCount()
+{
+  return 0;
+}
+
+const char *MemoryStream::subStreamName(unsigned)
+{
+  return nullptr;
+}
+
+bool MemoryStream::existsSubStream(const char *)
+{
+  return false;
+}
+
+librevenge::RVNGInputStream *MemoryStream::getSubStreamByName(const char *)
+{
+  return nullptr;
+}
+
+librevenge::RVNGInputStream *MemoryStream::getSubStreamById(unsigned)
+{
+  return nullptr;
+}
+
+const unsigned char *MemoryStream::read(const unsigned long numBytes, unsigned long &numBytesRead)
+{
+  numBytesRead = 0;
+  if (numBytes == 0 || m_offset >= m_size)
+    return nullptr;
+
+  numBytesRead = numBytes < m_size - m_offset ? numBytes : m_size - m_offset;
+  const unsigned char *const data = m_data + m_offset;
+  m_offset += numBytesRead;
+  return data;
+}
+
+int MemoryStream::seek(const long offset, const librevenge::RVNG_SEEK_TYPE seekType)
+{
+  long pos = 0;
+  switch (seekType)
+  {
+  case librevenge::RVNG_SEEK_CUR:
+    pos = long(m_offset) + offset;
+    break;
+  case librevenge::RVNG_SEEK_SET:
+    pos = offset;
+    break;
+  case librevenge::RVNG_SEEK_END:
+    pos = long(m_size) + offset;
+    break;
+  default:
+    return -1;
+  }
+
+  if (pos < 0)
+  {
+    m_offset = 0;
+    return 1;
+  }
+  if ((unsigned long)pos > m_size)
+  {
+    m_offset = m_size;
+    return 1;
+  }
+  m_offset = (unsigned long)pos;
+  return 0;
+}
+
+long MemoryStream::tell()
+{
+  return long(m_offset);
+}
+
+bool MemoryStream::isEnd()
+{
+  return m_offset >= m_size;
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,53 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_MEMORYSTREAM_H
+#define INCLUDED_MEMORYSTREAM_H
+
+#include <librevenge-stream/librevenge-stream.h>
+
+namespace libmspub
+{
+
+/** Unstructured input stream over a buffer owned by someone else.
+ *
+ * Each instance has its own read position, so several of them can be
+ * used concurrently over the same data.
+ */
+class MemoryStream : public librevenge::RVNGInputStream
+{
+public:
+  MemoryStream(const unsigned char *data, unsigned long size);
+  ~MemoryStream() override;
+
+  bool isStructured() override;
+  unsigned subStreamCount() override;
+  const char *subStreamName(unsigned id) override;
+  bool existsSubStream(const char *name) override;
+  librevenge::RVNGInputStream *getSubStreamByName(const char *name) override;
+  librevenge::RVNGInputStream *getSubStreamById(unsigned id) override;
+
+  const unsigned char *read(unsigned long numBytes, unsigned long &numBytesRead) override;
+  int seek(long offset, librevenge::RVNG_SEEK_TYPE seekType) override;
+  long tell() override;
+  bool isEnd() override;
+
+private:
+  MemoryStream(const MemoryStream &);
+  MemoryStream &operator=(const MemoryStream &);
+
+  const unsigned char *const m_data;
+  const unsigned long m_size;
+  unsigned long m_offset;
+};
+
+}
+
+#endif // INCLUDED_MEMORYSTREAM_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
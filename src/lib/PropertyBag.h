@@ -0,0 +1,136 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_PROPERTYBAG_H
+#define INCLUDED_PROPERTYBAG_H
+
+#include <algorithm>
+#include <utility>
+
+#include <boost/container/small_vector.hpp>
+
+namespace libmspub
+{
+
+/** Map from Escher property ids to values, kept as a sorted flat array.
+ *
+ * Escher property tables are short and are nearly always stored in
+ * ascending id order, so appending is the common case and lookups are a
+ * binary search over storage that lives inline for up to N entries. The
+ * interface mirrors the parts of std::map used with getIfExists().
+ */
+template <typename V, unsigned N>
+class PropertyBag
+{
+public:
+  typedef unsigned short key_type;
+  typedef V mapped_type;
+  typedef std::pair<unsigned short, V> value_type;
+
+private:
+  typedef boost::container::small_vector<value_type, N> Storage_t;
+
+public:
+  typedef typename Storage_t::iterator iterator;
+  typedef typename Storage_t::const_iterator const_iterator;
+
+  PropertyBag() : m_values()
+  {
+  }
+
+  void reserve(std::size_t size)
+  {
+    m_values.reserve(size);
+  }
+
+  /// Sets the value of a property, replacing any previous value.
+  void set(key_type key, const V &value)
+  {
+    if (m_values.empty() || m_values.back().first < key)
+    {
+      m_values.push_back(value_type(key, value));
+      return;
+    }
+    const iterator it = lowerBound(key);
+    if (it != m_values.end() && it->first == key)
+      it->second = value;
+    else
+      m_values.insert(it, value_type(key, value));
+  }
+
+  iterator find(key_type key)
+  {
+    const iterator it = lowerBound(key);
+    return (it != m_values.end() && it->first == key) ? it : m_values.end();
+  }
+
+  const_iterator find(key_type key) const
+  {
+    const const_iterator it = std::lower_bound(m_values.begin(), m_values.end(), key, KeyLess());
+    return (it != m_values.end() && it->first == key) ? it : m_values.end();
+  }
+
+  /// Returns the value of a property, or @c def if it is not set.
+  V get(key_type key, const V &def = V()) const
+  {
+    const const_iterator it = find(key);
+    return it == end() ? def : it->second;
+  }
+
+  iterator begin()
+  {
+    return m_values.begin();
+  }
+
+  iterator end()
+  {
+    return m_values.end();
+  }
+
+  const_iterator begin() const
+  {
+    return m_values.begin();
+  }
+
+  const_iterator end() const
+  {
+    return m_values.end();
+  }
+
+  std::size_t size() const
+  {
+    return m_values.size();
+  }
+
+  bool empty() const
+  {
+    return m_values.empty();
+  }
+
+private:
+  struct KeyLess
+  {
+    bool operator()(const value_type &value, key_type key) const
+    {
+      return value.first < key;
+    }
+  };
+
+  iterator lowerBound(key_type key)
+  {
+    return std::lower_bound(m_values.begin(), m_values.end(), key, KeyLess());
+  }
+
+  Storage_t m_values;
+};
+
+}
+
+#endif /* INCLUDED_PROPERTYBAG_H */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
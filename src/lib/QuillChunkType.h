@@ -0,0 +1,36 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_QUILLCHUNKTYPE_H
+#define INCLUDED_QUILLCHUNKTYPE_H
+
+#define MSPUB_FOURCC(a, b, c, d) \
+  ((unsigned(static_cast<unsigned char>(a)) << 24) | (unsigned(static_cast<unsigned char>(b)) << 16) \
+   | (unsigned(static_cast<unsigned char>(c)) << 8) | unsigned(static_cast<unsigned char>(d)))
+
+namespace libmspub
+{
+/// Quill chunk names, packed in file order with the first character in the high byte.
+enum QuillChunkType
+{
+  QUILL_UNKNOWN_CHUNK = 0,
+  QUILL_TEXT = MSPUB_FOURCC('T', 'E', 'X', 'T'),
+  QUILL_STRS = MSPUB_FOURCC('S', 'T', 'R', 'S'),
+  QUILL_SYID = MSPUB_FOURCC('S', 'Y', 'I', 'D'),
+  QUILL_PL   = MSPUB_FOURCC('P', 'L', ' ', ' '),
+  QUILL_FDPC = MSPUB_FOURCC('F', 'D', 'P', 'C'),
+  QUILL_FDPP = MSPUB_FOURCC('F', 'D', 'P', 'P'),
+  QUILL_STSH = MSPUB_FOURCC('S', 'T', 'S', 'H'),
+  QUILL_FONT = MSPUB_FOURCC('F', 'O', 'N', 'T'),
+  QUILL_TCD  = MSPUB_FOURCC('T', 'C', 'D', ' ')
+};
+} // namespace libmspub
+
+#endif /* INCLUDED_QUILLCHUNKTYPE_H */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,450 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "RecordingPainter.h"
+
+namespace libmspub
+{
+
+RecordingPainter::RecordingPainter()
+  : m_calls()
+  , m_propLists()
+  , m_texts()
+{
+}
+
+RecordingPainter::~RecordingPainter()
+{
+}
+
+void RecordingPainter::record(const Operation operation)
+{
+  m_calls.push_back(Call(operation, 0));
+}
+
+void RecordingPainter::record(const Operation operation, const librevenge::RVNGPropertyList &propList)
+{
+  m_calls.push_back(Call(operation, unsigned(m_propLists.size())));
+  m_propLists.push_back(propList);
+}
+
+void RecordingPainter::replay(librevenge::RVNGDrawingInterface *const painter) const
+{
+  for (const auto &call : m_calls)
+  {
+    switch (call.m_operation)
+    {
+    case START_DOCUMENT:
+      painter->startDocument(m_propLists[call.m_argument]);
+      break;
+    case END_DOCUMENT:
+      painter->endDocument();
+      break;
+    case SET_DOCUMENT_META_DATA:
+      painter->setDocumentMetaData(m_propLists[call.m_argument]);
+      break;
+    case DEFINE_EMBEDDED_FONT:
+      painter->defineEmbeddedFont(m_propLists[call.m_argument]);
+      break;
+    case START_PAGE:
+      painter->startPage(m_propLists[call.m_argument]);
+      break;
+    case END_PAGE:
+      painter->endPage();
+      break;
+    case START_MASTER_PAGE:
+      painter->startMasterPage(m_propLists[call.m_argument]);
+      break;
+    case END_MASTER_PAGE:
+      painter->endMasterPage();
+      break;
+    case SET_STYLE:
+      painter->setStyle(m_propLists[call.m_argument]);
+      break;
+    case START_LAYER:
+      painter->startLayer(m_propLists[call.m_argument]);
+      break;
+    case END_LAYER:
+      painter->endLayer();
+      break;
+    case START_EMBEDDED_GRAPHICS:
+      painter->startEmbeddedGraphics(m_propLists[call.m_argument]);
+      break;
+    case END_EMBEDDED_GRAPHICS:
+      painter->endEmbeddedGraphics();
+      break;
+    case OPEN_GROUP:
+      painter->openGroup(m_propLists[call.m_argument]);
+      break;
+    case CLOSE_GROUP:
+      painter->closeGroup();
+      break;
+    case DRAW_RECTANGLE:
+      painter->drawRectangle(m_propLists[call.m_argument]);
+      break;
+    case DRAW_ELLIPSE:
+      painter->drawEllipse(m_propLists[call.m_argument]);
+      break;
+    case DRAW_POLYLINE:
+      painter->drawPolyline(m_propLists[call.m_argument]);
+      break;
+    case DRAW_POLYGON:
+      painter->drawPolygon(m_propLists[call.m_argument]);
+      break;
+    case DRAW_PATH:
+      painter->drawPath(m_propLists[call.m_argument]);
+      break;
+    case DRAW_GRAPHIC_OBJECT:
+      painter->drawGraphicObject(m_propLists[call.m_argument]);
+      break;
+    case DRAW_CONNECTOR:
+      painter->drawConnector(m_propLists[call.m_argument]);
+      break;
+    case START_TEXT_OBJECT:
+      painter->startTextObject(m_propLists[call.m_argument]);
+      break;
+    case END_TEXT_OBJECT:
+      painter->endTextObject();
+      break;
+    case START_TABLE_OBJECT:
+      painter->startTableObject(m_propLists[call.m_argument]);
+      break;
+    case OPEN_TABLE_ROW:
+      painter->openTableRow(m_propLists[call.m_argument]);
+      break;
+    case CLOSE_TABLE_ROW:
+      painter->closeTableRow();
+      break;
+    case OPEN_TABLE_CELL:
+      painter->openTableCell(m_propLists[call.m_argument]);
+      break;
+    case CLOSE_TABLE_CELL:
+      painter->closeTableCell();
+      break;
+    case INSERT_COVERED_TABLE_CELL:
+      painter->insertCoveredTableCell(m_propLists[call.m_argument]);
+      break;
+    case END_TABLE_OBJECT:
+      painter->endTableObject();
+      break;
+    case OPEN_ORDERED_LIST_LEVEL:
+      painter->openOrderedListLevel(m_propLists[call.m_argument]);
+      break;
+    case CLOSE_ORDERED_LIST_LEVEL:
+      painter->closeOrderedListLevel();
+      break;
+    case OPEN_UNORDERED_LIST_LEVEL:
+      painter->openUnorderedListLevel(m_propLists[call.m_argument]);
+      break;
+    case CLOSE_UNORDERED_LIST_LEVEL:
+      painter->closeUnorderedListLevel();
+      break;
+    case OPEN_LIST_ELEMENT:
+      painter->openListElement(m_propLists[call.m_argument]);
+      break;
+    case CLOSE_LIST_ELEMENT:
+      painter->closeListElement();
+      break;
+    case DEFINE_PARAGRAPH_STYLE:
+      painter->defineParagraphStyle(m_propLists[call.m_argument]);
+      break;
+    case OPEN_PARAGRAPH:
+      painter->openParagraph(m_propLists[call.m_argument]);
+      break;
+    case CLOSE_PARAGRAPH:
+      painter->closeParagraph();
+      break;
+    case DEFINE_CHARACTER_STYLE:
+      painter->defineCharacterStyle(m_propLists[call.m_argument]);
+      break;
+    case OPEN_SPAN:
+      painter->openSpan(m_propLists[call.m_argument]);
+      break;
+    case CLOSE_SPAN:
+      painter->closeSpan();
+      break;
+    case OPEN_LINK:
+      painter->openLink(m_propLists[call.m_argument]);
+      break;
+    case CLOSE_LINK:
+      painter->closeLink();
+      break;
+    case INSERT_TAB:
+      painter->insertTab();
+      break;
+    case INSERT_SPACE:
+      painter->insertSpace();
+      break;
+    case INSERT_TEXT:
+      painter->insertText(m_texts[call.m_argument]);
+      break;
+    case INSERT_LINE_BREAK:
+      painter->insertLineBreak();
+      break;
+    case INSERT_FIELD:
+      painter->insertField(m_propLists[call.m_argument]);
+      break;
+    }
+  }
+}
+
+void RecordingPainter::startDocument(const librevenge::RVNGPropertyList &propList)
+{
+  record(START_DOCUMENT, propList);
+}
+
+void RecordingPainter::endDocument()
+{
+  record(END_DOCUMENT);
+}
+
+void RecordingPainter::setDocumentMetaData(const librevenge::RVNGPropertyList &propList)
+{
+  record(SET_DOCUMENT_META_DATA, propList);
+}
+
+void RecordingPainter::defineEmbeddedFont(const librevenge::RVNGPropertyList &propList)
+{
+  record(DEFINE_EMBEDDED_FONT, propList);
+}
+
+void RecordingPainter::startPage(const librevenge::RVNGPropertyList &propList)
+{
+  record(START_PAGE, propList);
+}
+
+void RecordingPainter::endPage()
+{
+  record(END_PAGE);
+}
+
+void RecordingPainter::startMasterPage(const librevenge::RVNGPropertyList &propList)
+{
+  record(START_MASTER_PAGE, propList);
+}
+
+void RecordingPainter::endMasterPage()
+{
+  record(END_MASTER_PAGE);
+}
+
+void RecordingPainter::setStyle(const librevenge::RVNGPropertyList &propList)
+{
+  record(SET_STYLE, propList);
+}
+
+void RecordingPainter::startLayer(const librevenge::RVNGPropertyList &propList)
+{
+  record(START_LAYER, propList);
+}
+
+void RecordingPainter::endLayer()
+{
+  record(END_LAYER);
+}
+
+void RecordingPainter::startEmbeddedGraphics(const librevenge::RVNGPropertyList &propList)
+{
+  record(START_EMBEDDED_GRAPHICS, propList);
+}
+
+void RecordingPainter::endEmbeddedGraphics()
+{
+  record(END_EMBEDDED_GRAPHICS);
+}
+
+void RecordingPainter::openGroup(const librevenge::RVNGPropertyList &propList)
+{
+  record(OPEN_GROUP, propList);
+}
+
+void RecordingPainter::closeGroup()
+{
+  record(CLOSE_GROUP);
+}
+
+void RecordingPainter::drawRectangle(const librevenge::RVNGPropertyList &propList)
+{
+  record(DRAW_RECTANGLE, propList);
+}
+
+void RecordingPainter::drawEllipse(const librevenge::RVNGPropertyList &propList)
+{
+  record(DRAW_ELLIPSE, propList);
+}
+
+void RecordingPainter::drawPolyline(const librevenge::RVNGPropertyList &propList)
+{
+  record(DRAW_POLYLINE, propList);
+}
+
+void RecordingPainter::drawPolygon(const librevenge::RVNGPropertyList &propList)
+{
+  record(DRAW_POLYGON, propList);
+}
+
+void RecordingPainter::drawPath(const librevenge::RVNGPropertyList &propList)
+{
+  record(DRAW_PATH, propList);
+}
+
+void RecordingPainter::drawGraphicObject(const librevenge::RVNGPropertyList &propList)
+{
+  record(DRAW_GRAPHIC_OBJECT, propList);
+}
+
+void RecordingPainter::drawConnector(const librevenge::RVNGPropertyList &propList)
+{
+  record(DRAW_CONNECTOR, propList);
+}
+
+void RecordingPainter::startTextObject(const librevenge::RVNGPropertyList &propList)
+{
+  record(START_TEXT_OBJECT, propList);
+}
+
+void RecordingPainter::endTextObject()
+{
+  record(END_TEXT_OBJECT);
+}
+
+void RecordingPainter::startTableObject(const librevenge::RVNGPropertyList &propList)
+{
+  record(START_TABLE_OBJECT, propList);
+}
+
+void RecordingPainter::openTableRow(const librevenge::RVNGPropertyList &propList)
+{
+  record(OPEN_TABLE_ROW, propList);
+}
+
+void RecordingPainter::closeTableRow()
+{
+  record(CLOSE_TABLE_ROW);
+}
+
+void RecordingPainter::openTableCell(const librevenge::RVNGPropertyList &propList)
+{
+  record(OPEN_TABLE_CELL, propList);
+}
+
+void RecordingPainter::closeTableCell()
+{
+  record(CLOSE_TABLE_CELL);
+}
+
+void RecordingPainter::insertCoveredTableCell(const librevenge::RVNGPropertyList &propList)
+{
+  record(INSERT_COVERED_TABLE_CELL, propList);
+}
+
+void RecordingPainter::endTableObject()
+{
+  record(END_TABLE_OBJECT);
+}
+
+void RecordingPainter::openOrderedListLevel(const librevenge::RVNGPropertyList &propList)
+{
+  record(OPEN_ORDERED_LIST_LEVEL, propList);
+}
+
+void RecordingPainter::closeOrderedListLevel()
+{
+  record(CLOSE_ORDERED_LIST_LEVEL);
+}
+
+void RecordingPainter::openUnorderedListLevel(const librevenge::RVNGPropertyList &propList)
+{
+  record(OPEN_UNORDERED_LIST_LEVEL, propList);
+}
+
+void RecordingPainter::closeUnorderedListLevel()
+{
+  record(CLOSE_UNORDERED_LIST_LEVEL);
+}
+
+void RecordingPainter::openListElement(const librevenge::RVNGPropertyList &propList)
+{
+  record(OPEN_LIST_ELEMENT, propList);
+}
+
+void RecordingPainter::closeListElement()
+{
+  record(CLOSE_LIST_ELEMENT);
+}
+
+void RecordingPainter::defineParagraphStyle(const librevenge::RVNGPropertyList &propList)
+{
+  record(DEFINE_PARAGRAPH_STYLE, propList);
+}
+
+void RecordingPainter::openParagraph(const librevenge::RVNGPropertyList &propList)
+{
+  record(OPEN_PARAGRAPH, propList);
+}
+
+void RecordingPainter::closeParagraph()
+{
+  record(CLOSE_PARAGRAPH);
+}
+
+void RecordingPainter::defineCharacterStyle(const librevenge::RVNGPropertyList &propList)
+{
+  record(DEFINE_CHARACTER_STYLE, propList);
+}
+
+void RecordingPainter::openSpan(const librevenge::RVNGPropertyList &propList)
+{
+  record(OPEN_SPAN, propList);
+}
+
+void RecordingPainter::closeSpan()
+{
+  record(CLOSE_SPAN);
+}
+
+void RecordingPainter::openLink(const librevenge::RVNGPropertyList &propList)
+{
+  record(OPEN_LINK, propList);
+}
+
+void RecordingPainter::closeLink()
+{
+  record(CLOSE_LINK);
+}
+
+void RecordingPainter::insertTab()
+{
+  record(INSERT_TAB);
+}
+
+void RecordingPainter::insertSpace()
+{
+  record(INSERT_SPACE);
+}
+
+void RecordingPainter::insertText(const librevenge::RVNGString &text)
+{
+  m_calls.push_back(Call(INSERT_TEXT, unsigned(m_texts.size())));
+  m_texts.push_back(text);
+}
+
+void RecordingPainter::insertLineBreak()
+{
+  record(INSERT_LINE_BREAK);
+}
+
+void RecordingPainter::insertField(const librevenge::RVNGPropertyList &propList)
+{
+  record(INSERT_FIELD, propList);
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,171 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_RECORDINGPAINTER_H
+#define INCLUDED_RECORDINGPAINTER_H
+
+#include <vector>
+
+#include <librevenge/librevenge.h>
+
+namespace libmspub
+{
+
+/** Drawing interface that records the calls made to it.
+ *
+ * The recorded calls can then be replayed, in the same order, into
+ * another drawing interface. This lets pages be painted on worker
+ * threads while the real painter only ever sees one thread.
+ */
+class RecordingPainter : public librevenge::RVNGDrawingInterface
+{
+public:
+  RecordingPainter();
+  ~RecordingPainter() override;
+
+  /// Makes the recorded calls on painter.
+  void replay(librevenge::RVNGDrawingInterface *painter) const;
+
+  void startDocument(const librevenge::RVNGPropertyList &propList) override;
+  void endDocument() override;
+  void setDocumentMetaData(const librevenge::RVNGPropertyList &propList) override;
+  void defineEmbeddedFont(const librevenge::RVNGPropertyList &propList) override;
+
+  void startPage(const librevenge::RVNGPropertyList &propList) override;
+  void endPage() override;
+  void startMasterPage(const librevenge::RVNGPropertyList &propList) override;
+  void endMasterPage() override;
+
+  void setStyle(const librevenge::RVNGPropertyList &propList) override;
+  void startLayer(const librevenge::RVNGPropertyList &propList) override;
+  void endLayer() override;
+  void startEmbeddedGraphics(const librevenge::RVNGPropertyList &propList) override;
+  void endEmbeddedGraphics() override;
+
+  void openGroup(const librevenge::RVNGPropertyList &propList) override;
+  void closeGroup() override;
+  void drawRectangle(const librevenge::RVNGPropertyList &propList) override;
+  void drawEllipse(const librevenge::RVNGPropertyList &propList) override;
+  void drawPolyline(const librevenge::RVNGPropertyList &propList) override;
+  void drawPolygon(const librevenge::RVNGPropertyList &propList) override;
+  void drawPath(const librevenge::RVNGPropertyList &propList) override;
+  void drawGraphicObject(const librevenge::RVNGPropertyList &propList) override;
+  void drawConnector(const librevenge::RVNGPropertyList &propList) override;
+
+  void startTextObject(const librevenge::RVNGPropertyList &propList) override;
+  void endTextObject() override;
+  void startTableObject(const librevenge::RVNGPropertyList &propList) override;
+  void openTableRow(const librevenge::RVNGPropertyList &propList) override;
+  void closeTableRow() override;
+  void openTableCell(const librevenge::RVNGPropertyList &propList) override;
+  void closeTableCell() override;
+  void insertCoveredTableCell(const librevenge::RVNGPropertyList &propList) override;
+  void endTableObject() override;
+
+  void openOrderedListLevel(const librevenge::RVNGPropertyList &propList) override;
+  void closeOrderedListLevel() override;
+  void openUnorderedListLevel(const librevenge::RVNGPropertyList &propList) override;
+  void closeUnorderedListLevel() override;
+  void openListElement(const librevenge::RVNGPropertyList &propList) override;
+  void closeListElement() override;
+
+  void defineParagraphStyle(const librevenge::RVNGPropertyList &propList) override;
+  void openParagraph(const librevenge::RVNGPropertyList &propList) override;
+  void closeParagraph() override;
+  void defineCharacterStyle(const librevenge::RVNGPropertyList &propList) override;
+  void openSpan(const librevenge::RVNGPropertyList &propList) override;
+  void closeSpan() override;
+  void openLink(const librevenge::RVNGPropertyList &propList) override;
+  void closeLink() override;
+
+  void insertTab() override;
+  void insertSpace() override;
+  void insertText(const librevenge::RVNGString &text) override;
+  void insertLineBreak() override;
+  void insertField(const librevenge::RVNGPropertyList &propList) override;
+
+private:
+  RecordingPainter(const RecordingPainter &);
+  RecordingPainter &operator=(const RecordingPainter &);
+
+  enum Operation
+  {
+    START_DOCUMENT,
+    END_DOCUMENT,
+    SET_DOCUMENT_META_DATA,
+    DEFINE_EMBEDDED_FONT,
+    START_PAGE,
+    END_PAGE,
+    START_MASTER_PAGE,
+    END_MASTER_PAGE,
+    SET_STYLE,
+    START_LAYER,
+    END_LAYER,
+    START_EMBEDDED_GRAPHICS,
+    END_EMBEDDED_GRAPHICS,
+    OPEN_GROUP,
+    CLOSE_GROUP,
+    DRAW_RECTANGLE,
+    DRAW_ELLIPSE,
+    DRAW_POLYLINE,
+    DRAW_POLYGON,
+    DRAW_PATH,
+    DRAW_GRAPHIC_OBJECT,
+    DRAW_CONNECTOR,
+    START_TEXT_OBJECT,
+    END_TEXT_OBJECT,
+    START_TABLE_OBJECT,
+    OPEN_TABLE_ROW,
+    CLOSE_TABLE_ROW,
+    OPEN_TABLE_CELL,
+    CLOSE_TABLE_CELL,
+    INSERT_COVERED_TABLE_CELL,
+    END_TABLE_OBJECT,
+    OPEN_ORDERED_LIST_LEVEL,
+    CLOSE_ORDERED_LIST_LEVEL,
+    OPEN_UNORDERED_LIST_LEVEL,
+    CLOSE_UNORDERED_LIST_LEVEL,
+    OPEN_LIST_ELEMENT,
+    CLOSE_LIST_ELEMENT,
+    DEFINE_PARAGRAPH_STYLE,
+    OPEN_PARAGRAPH,
+    CLOSE_PARAGRAPH,
+    DEFINE_CHARACTER_STYLE,
+    OPEN_SPAN,
+    CLOSE_SPAN,
+    OPEN_LINK,
+    CLOSE_LINK,
+    INSERT_TAB,
+    INSERT_SPACE,
+    INSERT_TEXT,
+    INSERT_LINE_BREAK,
+    INSERT_FIELD
+  };
+
+  struct Call
+  {
+    Call(Operation operation, unsigned argument) : m_operation(operation), m_argument(argument) { }
+
+    Operation m_operation;
+    // index into m_propLists or m_texts, for the calls that take an argument
+    unsigned m_argument;
+  };
+
+  void record(Operation operation);
+  void record(Operation operation, const librevenge::RVNGPropertyList &propList);
+
+  std::vector<Call> m_calls;
+  std::vector<librevenge::RVNGPropertyList> m_propLists;
+  std::vector<librevenge::RVNGString> m_texts;
+};
+
+}
+
+#endif // INCLUDED_RECORDINGPAINTER_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
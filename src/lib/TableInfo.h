@@ -31,6 +31,20 @@ struct CellInfo
   unsigned m_endColumn;
 };
 
+struct TableLayoutCell
+{
+  TableLayoutCell()
+    : m_cell(0)
+    , m_rowSpan(0)
+    , m_colSpan(0)
+  {
+  }
+
+  unsigned m_cell;
+  unsigned m_rowSpan; // 0 if covered by another cell
+  unsigned m_colSpan; // 0 if covered by another cell
+};
+
 struct TableInfo
 {
   std::vector<unsigned> m_rowHeightsInEmu;
@@ -38,9 +52,11 @@ struct TableInfo
   unsigned m_numRows;
   unsigned m_numColumns;
   std::vector<CellInfo> m_cells;
+  // m_numRows x m_numColumns, row by row; filled in by MSPUBCollector
+  std::vector<TableLayoutCell> m_layout;
   TableInfo(unsigned numRows, unsigned numColumns) : m_rowHeightsInEmu(),
     m_columnWidthsInEmu(), m_numRows(numRows), m_numColumns(numColumns),
-    m_cells()
+    m_cells(), m_layout()
   {
   }
 };
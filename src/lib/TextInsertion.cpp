@@ -0,0 +1,127 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "TextInsertion.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace libmspub
+{
+
+namespace
+{
+
+const uint64_t EVERY_BYTE = 0x0101010101010101ull;
+const uint64_t LOW_SEVEN_BITS = 0x7f7f7f7f7f7f7f7full;
+
+/// Sets the high bit of each byte of word that is equal to c, and clears all other bits.
+uint64_t matchBytes(const uint64_t word, const unsigned char c)
+{
+  const uint64_t x = word ^ (EVERY_BYTE * c);
+  return ~(((x & LOW_SEVEN_BITS) + LOW_SEVEN_BITS) | x | LOW_SEVEN_BITS);
+}
+
+/* Tabs and line breaks are inserted as elements of their own, as is
+ * every space of a run after the first one (otherwise the consumer would
+ * collapse the run).
+ */
+bool isTextBreak(const char *const text, const std::size_t pos)
+{
+  switch (text[pos])
+  {
+  case '\t':
+  case '\n':
+    return true;
+  case ' ':
+    return pos > 0 && text[pos - 1] == ' ';
+  default:
+    return false;
+  }
+}
+
+/// Checks 8 bytes starting at pos at once; false means that none of them is a break.
+bool mayContainTextBreak(const char *const text, const std::size_t pos)
+{
+  uint64_t word;
+  std::memcpy(&word, text + pos, sizeof(word));
+  const uint64_t spaces = matchBytes(word, ' ');
+  if ((matchBytes(word, '\t') | matchBytes(word, '\n') | (spaces & (spaces << 8))) != 0)
+    return true;
+  return pos > 0 && text[pos] == ' ' && text[pos - 1] == ' ';
+}
+
+// These are all ASCII, so they can be searched for in UTF-8 byte by byte.
+std::size_t findTextBreak(const char *const text, std::size_t pos, const std::size_t end)
+{
+  while (pos < end)
+  {
+    if (end - pos >= sizeof(uint64_t) && !mayContainTextBreak(text, pos))
+    {
+      pos += sizeof(uint64_t);
+      continue;
+    }
+    const std::size_t stop = std::min(pos + sizeof(uint64_t), end);
+    for (; pos < stop; ++pos)
+    {
+      if (isTextBreak(text, pos))
+        return pos;
+    }
+  }
+  return end;
+}
+
+void insertTextSlice(librevenge::RVNGDrawingInterface *iface, const char *const text, const std::size_t length)
+{
+  iface->insertText(librevenge::RVNGString(std::string(text, length).c_str()));
+}
+
+}
+
+void separateSpacesAndInsertText(librevenge::RVNGDrawingInterface *iface, const librevenge::RVNGString &text)
+{
+  if (!iface)
+    return;
+  const char *const str = text.cstr();
+  const std::size_t size = text.size();
+  std::size_t pos = findTextBreak(str, 0, size);
+  if (pos == size)
+  {
+    iface->insertText(text);
+    return;
+  }
+  std::size_t start = 0;
+  while (pos != size)
+  {
+    if (start != pos)
+      insertTextSlice(iface, str + start, pos - start);
+    switch (str[pos])
+    {
+    case '\t':
+      iface->insertTab();
+      break;
+    case '\n':
+      iface->insertLineBreak();
+      break;
+    default:
+      iface->insertSpace();
+      break;
+    }
+    start = pos + 1;
+    pos = findTextBreak(str, start, size);
+  }
+  if (start != size)
+    insertTextSlice(iface, str + start, size - start);
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
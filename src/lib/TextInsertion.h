@@ -0,0 +1,29 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_TEXTINSERTION_H
+#define INCLUDED_TEXTINSERTION_H
+
+#include <librevenge/librevenge.h>
+
+namespace libmspub
+{
+
+/** Passes text to iface, splitting it so that no whitespace is lost.
+ *
+ * Tabs and line breaks become insertTab() and insertLineBreak() calls,
+ * and every space of a run after the first one becomes an insertSpace()
+ * call; the rest is inserted as text.
+ */
+void separateSpacesAndInsertText(librevenge::RVNGDrawingInterface *iface, const librevenge::RVNGString &text);
+
+}
+
+#endif // INCLUDED_TEXTINSERTION_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
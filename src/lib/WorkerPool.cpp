@@ -0,0 +1,94 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace libmspub
+{
+
+namespace
+{
+
+struct TaskQueue
+{
+  TaskQueue(const std::size_t count, const std::function<void(std::size_t)> &task)
+    : m_count(count)
+    , m_task(task)
+    , m_next(0)
+    , m_firstFailure(count)
+    , m_exceptions(count)
+  {
+  }
+
+  void work()
+  {
+    for (std::size_t i = m_next++; i < m_count; i = m_next++)
+    {
+      if (i > m_firstFailure.load())
+        continue;
+      try
+      {
+        m_task(i);
+      }
+      catch (...)
+      {
+        m_exceptions[i] = std::current_exception();
+        std::size_t failure = m_firstFailure.load();
+        while (i < failure && !m_firstFailure.compare_exchange_weak(failure, i))
+          ;
+      }
+    }
+  }
+
+  const std::size_t m_count;
+  const std::function<void(std::size_t)> &m_task;
+  std::atomic<std::size_t> m_next;
+  std::atomic<std::size_t> m_firstFailure;
+  std::vector<std::exception_ptr> m_exceptions;
+};
+
+}
+
+unsigned getHardwareThreadCount()
+{
+  const unsigned count = std::thread::hardware_concurrency();
+  return count == 0 ? 1 : count;
+}
+
+void runTasks(const std::size_t count, const unsigned threadCount, const std::function<void(std::size_t)> &task)
+{
+  if (threadCount <= 1 || count <= 1)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+      task(i);
+    return;
+  }
+
+  TaskQueue queue(count, task);
+  std::vector<std::thread> threads;
+  const std::size_t extraThreads = (count < threadCount ? count : threadCount) - 1;
+  threads.reserve(extraThreads);
+  for (std::size_t i = 0; i < extraThreads; ++i)
+    threads.push_back(std::thread(&TaskQueue::work, &queue));
+  queue.work();
+  for (auto &thread : threads)
+    thread.join();
+
+  if (queue.m_firstFailure < count)
+    std::rethrow_exception(queue.m_exceptions[queue.m_firstFailure]);
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
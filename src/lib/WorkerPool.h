@@ -0,0 +1,37 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_WORKERPOOL_H
+#define INCLUDED_WORKERPOOL_H
+
+#include <cstddef>
+#include <functional>
+
+namespace libmspub
+{
+
+/** Returns the number of threads the hardware can run concurrently (at least 1).
+ */
+unsigned getHardwareThreadCount();
+
+/** Runs task(0), ..., task(count - 1) on at most threadCount threads.
+ *
+ * The calling thread takes part in the work, so no thread is started
+ * if threadCount or count is 1. Tasks are started in index order. If
+ * some tasks throw, the tasks after the first failing one are skipped
+ * where possible, and the exception of the lowest-indexed failing task
+ * is rethrown once all threads have finished, exactly as a serial loop
+ * would have thrown it.
+ */
+void runTasks(std::size_t count, unsigned threadCount, const std::function<void(std::size_t)> &task);
+
+}
+
+#endif // INCLUDED_WORKERPOOL_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -11,6 +11,8 @@
 
 #include <cstdarg>
 #include <cstring>
+#include <memory>
+#include <new>
 #include <string.h> // for memcpy
 
 #include <unicode/ucnv.h>
@@ -164,11 +166,72 @@ unsigned correctModulo(int x, unsigned n) // returns the canonical representatio
   return x % n;
 }
 
-librevenge::RVNGBinaryData inflateData(librevenge::RVNGBinaryData deflated)
+namespace
+{
+
+// deflate cannot compress better than about 1:1032
+const unsigned long MAX_DEFLATE_RATIO = 1032;
+
+// Larger data are inflated in chunks, so a bogus size cannot make us
+// allocate a huge buffer up front.
+const unsigned long MAX_PRESIZED_INFLATE_SIZE = 64 * 1024 * 1024;
+
+/** Inflates data whose inflated size is known in one go.
+  *
+  * Returns false if the data do not inflate to at most inflatedSize bytes,
+  * or if the buffer for them cannot be allocated.
+  */
+bool inflateKnownSize(const unsigned char *const deflated, const unsigned long size, const unsigned long inflatedSize, librevenge::RVNGBinaryData &inflated)
+{
+  // one more byte than needed, to find out if the size is too small
+  std::unique_ptr<unsigned char[]> out;
+  try
+  {
+    out.reset(new unsigned char[inflatedSize + 1]);
+  }
+  catch (const std::bad_alloc &)
+  {
+    return false;
+  }
+  z_stream strm;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.avail_in = 0;
+  strm.next_in = Z_NULL;
+  if (inflateInit2(&strm,-MAX_WBITS) != Z_OK)
+    return false;
+  strm.avail_in = static_cast<uInt>(size);
+  strm.next_in = const_cast<unsigned char *>(deflated);
+  strm.avail_out = static_cast<uInt>(inflatedSize + 1);
+  strm.next_out = out.get();
+  const int ret = inflate(&strm, Z_FINISH);
+  const unsigned long have = strm.total_out;
+  inflateEnd(&strm);
+  if (ret != Z_STREAM_END || have > inflatedSize)
+    return false;
+  inflated = librevenge::RVNGBinaryData(out.get(), have);
+  return true;
+}
+
+}
+
+librevenge::RVNGBinaryData inflateData(librevenge::RVNGBinaryData deflated, const unsigned long inflatedSize)
+{
+  return inflateData(deflated.getDataBuffer(), deflated.size(), inflatedSize);
+}
+
+librevenge::RVNGBinaryData inflateData(const unsigned char *deflated, const unsigned long size, const unsigned long inflatedSize)
 {
   librevenge::RVNGBinaryData inflated;
+  if (inflatedSize > 0 && inflatedSize / MAX_DEFLATE_RATIO <= size && inflatedSize <= MAX_PRESIZED_INFLATE_SIZE)
+  {
+    if (inflateKnownSize(deflated, size, inflatedSize, inflated))
+      return inflated;
+    MSPUB_DEBUG_MSG(("Could not inflate to 0x%lx bytes in one go, inflating in chunks\n", inflatedSize));
+  }
   unsigned char out[ZLIB_CHUNK];
-  const unsigned char *data = deflated.getDataBuffer();
+  const unsigned char *data = deflated;
   z_stream strm;
   int ret;
   strm.zalloc = Z_NULL;
@@ -181,7 +244,7 @@ librevenge::RVNGBinaryData inflateData(librevenge::RVNGBinaryData deflated)
     return librevenge::RVNGBinaryData();
   }
   int have;
-  unsigned left = deflated.size();
+  unsigned long left = size;
   do
   {
     strm.avail_in = ZLIB_CHUNK > left ? left : ZLIB_CHUNK;
@@ -346,6 +409,19 @@ void readNBytes(librevenge::RVNGInputStream *input, unsigned long length, std::v
   return;
 }
 
+void readBinaryData(librevenge::RVNGInputStream *const input, unsigned long length, librevenge::RVNGBinaryData &out)
+{
+  while (length > 0 && stillReading(input, (unsigned long)-1))
+  {
+    unsigned long howManyRead = 0;
+    const unsigned char *buf = input->read(length, howManyRead);
+    if (howManyRead == 0)
+      break;
+    out.append(buf, howManyRead);
+    length -= howManyRead;
+  }
+}
+
 unsigned long getLength(librevenge::RVNGInputStream *const input)
 {
   if (!input)
@@ -383,7 +459,13 @@ unsigned long getLength(librevenge::RVNGInputStream *const input)
 void appendCharacters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters,
                       const char *encoding)
 {
-  if (characters.empty())
+  appendCharacters(text, characters.data(), characters.size(), encoding);
+}
+
+void appendCharacters(librevenge::RVNGString &text, const unsigned char *characters, std::size_t size,
+                      const char *encoding)
+{
+  if (size == 0)
   {
     MSPUB_DEBUG_MSG(("Attempt to append 0 characters!"));
     return;
@@ -396,8 +478,8 @@ void appendCharacters(librevenge::RVNGString &text, const std::vector<unsigned c
   {
     // ICU documentation claims that character-by-character processing is faster "for small amounts of data" and "'normal' charsets"
     // (in any case, it is more convenient :) )
-    const auto *src = (const char *)characters.data();
-    const char *srcLimit = (const char *)src + characters.size();
+    const auto *src = (const char *)characters;
+    const char *srcLimit = (const char *)src + size;
     while (src < srcLimit)
     {
       auto ucs4Character = (uint32_t)ucnv_getNextUChar(conv, &src, srcLimit, &status);
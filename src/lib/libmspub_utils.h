@@ -43,7 +43,8 @@
 #  define MSPUB_FALLTHROUGH ((void) 0)
 #endif
 
-// do nothing with debug messages in a release compile
+// do nothing with debug messages in a release compile; in a debug compile,
+// each message is written with one call, so concurrent parses only interleave whole messages
 #ifdef DEBUG
 namespace libmspub
 {
@@ -71,10 +72,13 @@ int32_t readS32(librevenge::RVNGInputStream *input);
 double readFixedPoint(librevenge::RVNGInputStream *input);
 double toFixedPoint(int fp);
 void readNBytes(librevenge::RVNGInputStream *input, unsigned long length, std::vector<unsigned char> &out);
+/// Appends up to length bytes from the input to out, stopping early at the end of the input.
+void readBinaryData(librevenge::RVNGInputStream *input, unsigned long length, librevenge::RVNGBinaryData &out);
 
 unsigned long getLength(librevenge::RVNGInputStream *input);
 
 void appendCharacters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters, const char *encoding);
+void appendCharacters(librevenge::RVNGString &text, const unsigned char *characters, std::size_t size, const char *encoding);
 
 bool stillReading(librevenge::RVNGInputStream *input, unsigned long until);
 
@@ -110,7 +114,9 @@ class GenericException
 {
 };
 
-librevenge::RVNGBinaryData inflateData(librevenge::RVNGBinaryData);
+/// Inflates raw deflate data. If inflatedSize is not 0, it is the expected size of the result.
+librevenge::RVNGBinaryData inflateData(const unsigned char *deflated, unsigned long size, unsigned long inflatedSize = 0);
+librevenge::RVNGBinaryData inflateData(librevenge::RVNGBinaryData, unsigned long inflatedSize = 0);
 
 } // namespace libmspub
 
@@ -0,0 +1,218 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/* Parses documents on many threads at once and checks that every result
+ * is the same as that of a single-threaded parse.
+ *
+ * Every thread goes through all the given files, starting at a different
+ * one, so the same file is parsed concurrently as well as different ones.
+ * Each file is converted to SVG with MSPUBDocument::parse(), with default
+ * options and with parallel decoding and painting, with parseDocument()
+ * followed by render(), and by rendering a document parsed once and shared
+ * by all threads.
+ *
+ * To look for data races, build with ThreadSanitizer:
+ *   ./configure CXXFLAGS="-g -O1 -fsanitize=thread" LDFLAGS=-fsanitize=thread
+ *   make check
+ *   src/test/pubstress --threads 8 FILE...
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <librevenge/librevenge.h>
+#include <librevenge-stream/librevenge-stream.h>
+
+#include <libmspub/libmspub.h>
+
+namespace
+{
+
+struct Document
+{
+  explicit Document(const char *const name) : m_name(name), m_svg(), m_parsed() { }
+
+  std::string m_name;
+  std::string m_svg; // of the single-threaded parse
+  std::unique_ptr<libmspub::MSPUBParsedDocument> m_parsed;
+};
+
+std::string joinPages(const librevenge::RVNGStringVector &pages)
+{
+  std::string svg;
+  for (unsigned i = 0; i < pages.size(); ++i)
+  {
+    svg += pages[i].cstr();
+    svg += '\n';
+  }
+  return svg;
+}
+
+bool parseToSVG(const char *const name, const libmspub::MSPUBParseOptions *const options, std::string &svg)
+{
+  librevenge::RVNGFileStream input(name);
+  librevenge::RVNGStringVector pages;
+  librevenge::RVNGSVGDrawingGenerator generator(pages, "svg");
+  const bool ok = options ? libmspub::MSPUBDocument::parse(&input, &generator, *options)
+                  : libmspub::MSPUBDocument::parse(&input, &generator);
+  svg = joinPages(pages);
+  return ok;
+}
+
+bool parseDocumentToSVG(const char *const name, std::string &svg)
+{
+  librevenge::RVNGFileStream input(name);
+  const std::unique_ptr<libmspub::MSPUBParsedDocument> parsed(libmspub::MSPUBDocument::parseDocument(&input));
+  if (!parsed)
+    return false;
+  librevenge::RVNGStringVector pages;
+  librevenge::RVNGSVGDrawingGenerator generator(pages, "svg");
+  const bool ok = parsed->render(&generator);
+  svg = joinPages(pages);
+  return ok;
+}
+
+bool renderToSVG(const libmspub::MSPUBParsedDocument &parsed, std::string &svg)
+{
+  librevenge::RVNGStringVector pages;
+  librevenge::RVNGSVGDrawingGenerator generator(pages, "svg");
+  const bool ok = parsed.render(&generator);
+  svg = joinPages(pages);
+  return ok;
+}
+
+class StressRun
+{
+public:
+  StressRun(const std::vector<Document> &documents, const unsigned rounds)
+    : m_documents(documents)
+    , m_rounds(rounds)
+    , m_failures(0)
+    , m_reportMutex()
+  {
+  }
+
+  void run(const unsigned threadIndex)
+  {
+    libmspub::MSPUBParseOptions parallel;
+    parallel.setThreadCount(4);
+    parallel.setPipelined(true);
+
+    for (unsigned round = 0; round < m_rounds; ++round)
+    {
+      for (std::size_t i = 0; i < m_documents.size(); ++i)
+      {
+        const Document &document = m_documents[(threadIndex + i) % m_documents.size()];
+        std::string svg;
+        bool ok = parseToSVG(document.m_name.c_str(), nullptr, svg);
+        check(document, "parse()", ok, svg);
+        ok = parseToSVG(document.m_name.c_str(), &parallel, svg);
+        check(document, "parse() on 4 threads", ok, svg);
+        ok = parseDocumentToSVG(document.m_name.c_str(), svg);
+        check(document, "parseDocument()", ok, svg);
+        ok = renderToSVG(*document.m_parsed, svg);
+        check(document, "render() of a shared document", ok, svg);
+      }
+    }
+  }
+
+  unsigned getFailures() const
+  {
+    return m_failures;
+  }
+
+private:
+  void check(const Document &document, const char *const how, const bool ok, const std::string &svg)
+  {
+    if (ok && svg == document.m_svg)
+      return;
+    ++m_failures;
+    std::lock_guard<std::mutex> lock(m_reportMutex);
+    if (!ok)
+      fprintf(stderr, "%s: %s failed\n", document.m_name.c_str(), how);
+    else
+      fprintf(stderr, "%s: %s gave different output\n", document.m_name.c_str(), how);
+  }
+
+  const std::vector<Document> &m_documents;
+  const unsigned m_rounds;
+  std::atomic<unsigned> m_failures;
+  std::mutex m_reportMutex;
+};
+
+int printUsage()
+{
+  printf("Usage: pubstress [--threads N] [--rounds N] FILE...\n");
+  printf("\n");
+  printf("Parses the files on N threads (default 8), N rounds (default 2) each,\n");
+  printf("and checks that the output is the same as that of a single-threaded parse.\n");
+  return -1;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+  unsigned threadCount = 8;
+  unsigned rounds = 2;
+  std::vector<Document> documents;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      threadCount = unsigned(atoi(argv[++i]));
+    else if (!strcmp(argv[i], "--rounds") && i + 1 < argc)
+      rounds = unsigned(atoi(argv[++i]));
+    else if (strncmp(argv[i], "--", 2))
+      documents.push_back(Document(argv[i]));
+    else
+      return printUsage();
+  }
+  if (documents.empty() || threadCount == 0)
+    return printUsage();
+
+  for (auto &document : documents)
+  {
+    if (!parseToSVG(document.m_name.c_str(), nullptr, document.m_svg))
+    {
+      fprintf(stderr, "%s: cannot be parsed\n", document.m_name.c_str());
+      return 1;
+    }
+    librevenge::RVNGFileStream input(document.m_name.c_str());
+    document.m_parsed.reset(libmspub::MSPUBDocument::parseDocument(&input));
+    if (!document.m_parsed)
+    {
+      fprintf(stderr, "%s: parseDocument() failed\n", document.m_name.c_str());
+      return 1;
+    }
+  }
+
+  StressRun stressRun(documents, rounds);
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < threadCount; ++i)
+    threads.push_back(std::thread(&StressRun::run, &stressRun, i));
+  for (auto &thread : threads)
+    thread.join();
+
+  if (stressRun.getFailures() != 0)
+  {
+    fprintf(stderr, "%u runs differed from the single-threaded parse\n", stressRun.getFailures());
+    return 1;
+  }
+  return 0;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
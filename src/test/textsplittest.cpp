@@ -0,0 +1,209 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/* Compares separateSpacesAndInsertText() with the character-by-character
+ * splitting it replaced, on edge cases and on random UTF-8 text.
+ */
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <librevenge/librevenge.h>
+
+#include "RecordingPainter.h"
+#include "TextInsertion.h"
+
+namespace
+{
+
+/// Writes the text calls it gets into a string, in a form that shows where the text was split.
+class TextLogger : public libmspub::RecordingPainter
+{
+public:
+  TextLogger() : m_log() { }
+
+  void insertTab() override
+  {
+    m_log += "<tab>";
+  }
+  void insertSpace() override
+  {
+    m_log += "<space>";
+  }
+  void insertText(const librevenge::RVNGString &text) override
+  {
+    m_log += "[";
+    m_log += text.cstr();
+    m_log += "]";
+  }
+  void insertLineBreak() override
+  {
+    m_log += "<br>";
+  }
+
+  std::string m_log;
+};
+
+// The splitting as it was done before it scanned the bytes a word at a time.
+
+void separateTabsAndInsertTextOld(librevenge::RVNGDrawingInterface *iface, const librevenge::RVNGString &text)
+{
+  if (!iface || text.empty())
+    return;
+  librevenge::RVNGString tmpText;
+  librevenge::RVNGString::Iter i(text);
+  for (i.rewind(); i.next();)
+  {
+    if (*(i()) == '\t')
+    {
+      if (!tmpText.empty())
+      {
+        iface->insertText(tmpText);
+        tmpText.clear();
+      }
+      iface->insertTab();
+    }
+    else if (*(i()) == '\n')
+    {
+      if (!tmpText.empty())
+      {
+        iface->insertText(tmpText);
+        tmpText.clear();
+      }
+      iface->insertLineBreak();
+    }
+    else
+    {
+      tmpText.append(i());
+    }
+  }
+  if (!tmpText.empty())
+    iface->insertText(tmpText);
+}
+
+void separateSpacesAndInsertTextOld(librevenge::RVNGDrawingInterface *iface, const librevenge::RVNGString &text)
+{
+  if (!iface)
+    return;
+  if (text.empty())
+  {
+    iface->insertText(text);
+    return;
+  }
+  librevenge::RVNGString tmpText;
+  int numConsecutiveSpaces = 0;
+  librevenge::RVNGString::Iter i(text);
+  for (i.rewind(); i.next();)
+  {
+    if (*(i()) == ' ')
+      numConsecutiveSpaces++;
+    else
+      numConsecutiveSpaces = 0;
+
+    if (numConsecutiveSpaces > 1)
+    {
+      if (!tmpText.empty())
+      {
+        separateTabsAndInsertTextOld(iface, tmpText);
+        tmpText.clear();
+      }
+      iface->insertSpace();
+    }
+    else
+    {
+      tmpText.append(i());
+    }
+  }
+  separateTabsAndInsertTextOld(iface, tmpText);
+}
+
+bool check(const std::string &text)
+{
+  const librevenge::RVNGString str(text.c_str());
+  TextLogger expected;
+  separateSpacesAndInsertTextOld(&expected, str);
+  TextLogger actual;
+  libmspub::separateSpacesAndInsertText(&actual, str);
+  if (expected.m_log == actual.m_log)
+    return true;
+  fprintf(stderr, "text \"%s\" is split as\n  %s\nbut should be\n  %s\n", text.c_str(), actual.m_log.c_str(), expected.m_log.c_str());
+  return false;
+}
+
+std::vector<std::string> edgeCases()
+{
+  std::vector<std::string> cases;
+  cases.push_back("");
+  cases.push_back(" ");
+  cases.push_back("  ");
+  cases.push_back("\t");
+  cases.push_back("\n");
+  cases.push_back("no breaks at all, just single spaces");
+  cases.push_back("\t\tleading and trailing tabs\t\t");
+  cases.push_back("\n\nleading and trailing line breaks\n\n");
+  // space runs that start, end or are split at the 8-byte word boundaries
+  for (std::size_t offset = 0; offset < 17; ++offset)
+  {
+    for (std::size_t run = 1; run < 18; ++run)
+    {
+      cases.push_back(std::string(offset, 'x') + std::string(run, ' ') + "y");
+      cases.push_back(std::string(offset, 'x') + std::string(run, ' '));
+      cases.push_back(std::string(offset, 'x') + "\t" + std::string(run, ' ') + "\n");
+    }
+  }
+  // multibyte characters next to the breaks
+  cases.push_back("\xc3\xa9  \xc3\xa9");
+  cases.push_back("\xe2\x82\xac\t\xe2\x82\xac\n\xe2\x82\xac");
+  cases.push_back("\xf0\x9f\x98\x80   \xf0\x9f\x98\x80\xf0\x9f\x98\x80  ");
+  cases.push_back("1234567\xc3\xa9  x");
+  cases.push_back("123456\xe2\x82\xac  x");
+  return cases;
+}
+
+std::string randomText(std::mt19937 &rng)
+{
+  static const char *const pieces[] =
+  {
+    " ", " ", " ", "\t", "\n", "a", "b", "Z", ".",
+    "\xc3\xa9", // U+00E9
+    "\xe2\x82\xac", // U+20AC
+    "\xf0\x9f\x98\x80" // U+1F600
+  };
+  const std::size_t pieceCount = sizeof(pieces) / sizeof(pieces[0]);
+  std::uniform_int_distribution<std::size_t> length(0, 40);
+  std::uniform_int_distribution<std::size_t> piece(0, pieceCount - 1);
+  std::string text;
+  for (std::size_t n = length(rng); n > 0; --n)
+    text += pieces[piece(rng)];
+  return text;
+}
+
+}
+
+int main()
+{
+  unsigned failures = 0;
+  const std::vector<std::string> cases = edgeCases();
+  for (std::size_t i = 0; i < cases.size(); ++i)
+  {
+    if (!check(cases[i]))
+      ++failures;
+  }
+  std::mt19937 rng(20161); // fixed, so that failures can be reproduced
+  for (unsigned i = 0; i < 100000 && failures < 10; ++i)
+  {
+    if (!check(randomText(rng)))
+      ++failures;
+  }
+  return failures == 0 ? 0 : 1;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */